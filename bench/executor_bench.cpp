@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * A standalone driver that pushes statements through `SQL_Executor` using a
+ * stub connection (no database is needed) and reports the time spent by the
+ * statements between being queued and being executed.
+ *
+ *   make bench && ./bin/executor_bench [statements] [threads] [connections] [interval] [work]
+ *
+ * `interval` is the pause between two statements and `work` is the time each
+ * statement takes to execute (both in microseconds).
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/Clock.h"
+#include "../src/Logger.h"
+
+#include "../src/sql/SQL_Connection.h"
+#include "../src/sql/SQL_Dispatcher.h"
+#include "../src/sql/SQL_Executor.h"
+#include "../src/sql/SQL_Statement.h"
+
+/**
+ * The enqueue-to-execute latency of every statement (microseconds), indexed
+ * by statement ID.
+ */
+std::vector<unsigned long long> latencies;
+
+/**
+ * The number of statements executed.
+ */
+boost::atomic<int> executed(0);
+
+/**
+ * A connection that only records when its statements start executing.
+ */
+class Stub_Connection : public SQL_Connection {
+
+	public:
+
+		/**
+		 * The time each statement takes to execute (microseconds).
+		 */
+		int work;
+
+		Stub_Connection(int id, int work) : SQL_Connection(id, NULL) {
+			this->work = work;
+		}
+
+		bool connect(const char *host, const char *user, const char *pass, const char *db, int port) {
+			return true;
+		}
+
+		void disconnect() {
+		}
+
+		int getErrorId() {
+			return 0;
+		}
+
+		const char *getError() {
+			return "";
+		}
+
+		int ping() {
+			return 0;
+		}
+
+		const char *getStat() {
+			return "";
+		}
+
+		const char *getCharset() {
+			return "";
+		}
+
+		bool setCharset(char *charset) {
+			return true;
+		}
+
+		int escapeString(const char *src, char *&dest) {
+			return 0;
+		}
+
+		void executeStatement(SQL_Statement *stmt) {
+			latencies[stmt->id] = Clock::now() - stmt->queuedAt;
+			if (work != 0) {
+				unsigned long long end = Clock::now() + work;
+				while (Clock::now() < end) {
+					YIELD();
+				}
+			}
+			++executed;
+		}
+
+		void rollback() {
+		}
+
+		bool canRetry(SQL_Statement *stmt) {
+			return false;
+		}
+
+		char *getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert) {
+			return NULL;
+		}
+
+		void interrupt() {
+		}
+
+		bool keepAlive() {
+			return true;
+		}
+
+		bool seekResult(SQL_Statement *stmt, int resultIdx) {
+			return false;
+		}
+
+		bool fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+			return false;
+		}
+
+		bool seekRow(SQL_Statement *stmt, int rowIdx) {
+			return false;
+		}
+
+		bool fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+			return false;
+		}
+
+		bool fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len) {
+			return false;
+		}
+};
+
+/**
+ * Gets a percentile of the sorted latencies.
+ * @param sorted
+ * @param percentile
+ * @return
+ */
+unsigned long long getPercentile(const std::vector<unsigned long long> &sorted, double percentile) {
+	int idx = (int) (percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[idx];
+}
+
+int main(int argc, char **argv) {
+	int count = argc > 1 ? atoi(argv[1]) : 100000;
+	int threads = argc > 2 ? atoi(argv[2]) : EXECUTOR_DEFAULT_THREADS;
+	int connCount = argc > 3 ? atoi(argv[3]) : 4;
+	int interval = argc > 4 ? atoi(argv[4]) : 10;
+	int work = argc > 5 ? atoi(argv[5]) : 0;
+	if ((count < 1) || (connCount < 1)) {
+		printf("Usage: %s [statements] [threads] [connections] [interval] [work]\n", argv[0]);
+		return 1;
+	}
+	Logger::fileLevel = LOG_NONE;
+	Logger::consoleLevel = LOG_NONE;
+	latencies.resize(count);
+	SQL_Executor::start(threads);
+	std::vector<Stub_Connection*> conns;
+	for (int i = 0; i != connCount; ++i) {
+		Stub_Connection *conn = new Stub_Connection(i + 1, work);
+		conn->startWorker();
+		conns.push_back(conn);
+	}
+	std::vector<SQL_Statement*> stmts;
+	unsigned long long start = Clock::now();
+	for (int i = 0; i != count; ++i) {
+		SQL_Statement *stmt = new SQL_Statement(i, NULL, i % connCount + 1);
+		stmt->flags = STATEMENT_FLAGS_THREADED;
+		stmts.push_back(stmt);
+		conns[i % connCount]->schedule(stmt, NULL);
+		if (interval != 0) {
+			unsigned long long next = Clock::now() + interval;
+			while (Clock::now() < next) {
+				YIELD();
+			}
+		}
+		if (i % 1024 == 0) {
+			// The executed statements are never registered in the pools, the
+			// dispatcher only has to drop their IDs.
+			SQL_Dispatcher::tick();
+		}
+	}
+	while (executed != count) {
+		SQL_Dispatcher::tick();
+		SLEEP(1);
+	}
+	unsigned long long elapsed = Clock::now() - start;
+	for (int i = 0; i != connCount; ++i) {
+		delete conns[i];
+	}
+	SQL_Executor::stop();
+	SQL_Dispatcher::tick();
+	for (int i = 0; i != count; ++i) {
+		delete stmts[i];
+	}
+	std::sort(latencies.begin(), latencies.end());
+	printf("statements = %d, threads = %d, connections = %d, interval = %d us, work = %d us\n", count, threads, connCount, interval, work);
+	printf("total = %llu ms\n", elapsed / 1000);
+	printf("latency (us): p50 = %llu, p90 = %llu, p99 = %llu, p99.9 = %llu, max = %llu\n",
+		getPercentile(latencies, 50), getPercentile(latencies, 90), getPercentile(latencies, 99), getPercentile(latencies, 99.9), latencies.back());
+	return 0;
+}
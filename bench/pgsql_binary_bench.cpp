@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * A standalone driver that compares reading PostgreSQL results in text and
+ * in binary format (`QUERY_BINARY`). The results are built in memory (no
+ * server is needed) and every field is read through `PgSQL_Connection`, the
+ * way `sql_get_field_int` and `sql_get_field_float` read them.
+ *
+ *   make bench PGSQL=true && ./bin/pgsql_binary_bench [rows]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../src/Clock.h"
+#include "../src/Logger.h"
+
+#include "../src/sql/SQL_Statement.h"
+#include "../src/sql/pgsql/PgSQL_Connection.h"
+#include "../src/sql/pgsql/PgSQL_ResultSet.h"
+
+/**
+ * Writes an integer in network byte order.
+ * @param dest
+ * @param value
+ * @param len
+ */
+void writeInt(char *dest, unsigned long long value, int len) {
+	for (int i = len - 1; i >= 0; --i) {
+		dest[i] = (char) (value & 0xFF);
+		value >>= 8;
+	}
+}
+
+/**
+ * Builds a result with an `int4`, an `int8` and a `float8` column.
+ * @param rows
+ * @param format 1 for binary, 0 for text.
+ * @return
+ */
+PGresult *makeResult(int rows, int format) {
+	PGresult *result = PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+	PGresAttDesc attrs[3];
+	memset(attrs, 0, sizeof(attrs));
+	const char *names[] = {"id", "score", "ratio"};
+	const Oid types[] = {PGSQL_INT4OID, PGSQL_INT8OID, PGSQL_FLOAT8OID};
+	const int lengths[] = {4, 8, 8};
+	for (int i = 0; i != 3; ++i) {
+		attrs[i].name = (char*) names[i];
+		attrs[i].format = format;
+		attrs[i].typid = types[i];
+		attrs[i].typlen = lengths[i];
+		attrs[i].atttypmod = -1;
+	}
+	PQsetResultAttrs(result, 3, attrs);
+	char buf[32];
+	for (int i = 0; i != rows; ++i) {
+		double ratio = i / 7.0;
+		if (format == 1) {
+			writeInt(buf, (unsigned int) i, 4);
+			PQsetvalue(result, i, 0, buf, 4);
+			writeInt(buf, (unsigned long long) i * 1003ULL, 8);
+			PQsetvalue(result, i, 1, buf, 8);
+			unsigned long long bits;
+			memcpy(&bits, &ratio, sizeof(bits));
+			writeInt(buf, bits, 8);
+			PQsetvalue(result, i, 2, buf, 8);
+		} else {
+			PQsetvalue(result, i, 0, buf, snprintf(buf, sizeof(buf), "%d", i));
+			PQsetvalue(result, i, 1, buf, snprintf(buf, sizeof(buf), "%llu", (unsigned long long) i * 1003ULL));
+			PQsetvalue(result, i, 2, buf, snprintf(buf, sizeof(buf), "%.15g", ratio));
+		}
+	}
+	return result;
+}
+
+/**
+ * Reads every field of a result.
+ * @param conn
+ * @param rows
+ * @param format 1 for binary, 0 for text.
+ * @param sum Receives a checksum of the values read.
+ * @return The time spent reading (microseconds).
+ */
+unsigned long long readResult(PgSQL_Connection *conn, int rows, int format, double &sum) {
+	SQL_Statement *stmt = new SQL_Statement(1, NULL, 1);
+	PgSQL_ResultSet *r = new PgSQL_ResultSet();
+	r->result = makeResult(rows, format);
+	r->numRows = rows;
+	r->numFields = 3;
+	stmt->resultSets.push_back(r);
+	sum = 0;
+	unsigned long long start = Clock::now();
+	for (int i = 0; i != rows; ++i) {
+		int id, score;
+		float ratio;
+		conn->seekRow(stmt, i);
+		conn->fetchInt(stmt, 0, id);
+		conn->fetchInt(stmt, 1, score);
+		conn->fetchFloat(stmt, 2, ratio);
+		sum += id + score + ratio;
+	}
+	unsigned long long elapsed = Clock::now() - start;
+	delete stmt;
+	return elapsed;
+}
+
+int main(int argc, char **argv) {
+	int rows = argc > 1 ? atoi(argv[1]) : 100000;
+	if (rows < 1) {
+		printf("Usage: %s [rows]\n", argv[0]);
+		return 1;
+	}
+	Logger::fileLevel = LOG_NONE;
+	Logger::consoleLevel = LOG_NONE;
+	PgSQL_Connection *conn = new PgSQL_Connection(1, NULL);
+	double textSum, binarySum;
+	unsigned long long text = readResult(conn, rows, 0, textSum);
+	unsigned long long binary = readResult(conn, rows, 1, binarySum);
+	printf("rows = %d (int4, int8, float8)\n", rows);
+	printf("text = %llu us, binary = %llu us (checksums: %.0f, %.0f)\n", text, binary, textSum, binarySum);
+	delete conn;
+	return 0;
+}
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <ctime>
+#endif
+
+#include "Clock.h"
+
+unsigned long long Clock::now() {
+	#ifdef _WIN32
+		static LARGE_INTEGER frequency = {0};
+		if (frequency.QuadPart == 0) {
+			QueryPerformanceFrequency(&frequency);
+		}
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return (unsigned long long) ((counter.QuadPart / frequency.QuadPart) * 1000000ULL + ((counter.QuadPart % frequency.QuadPart) * 1000000ULL) / frequency.QuadPart);
+	#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+	#endif
+}
+
+int Clock::elapsed(unsigned long long start) {
+	return (int) ((now() - start) / 1000);
+}
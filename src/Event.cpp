@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _WIN32
+	#include <ctime>
+	#include <cerrno>
+#endif
+
+#include "Event.h"
+
+Event::Event() {
+	#ifdef _WIN32
+		handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+	#else
+		pthread_mutex_init(&mutex, NULL);
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&cond, &attr);
+		pthread_condattr_destroy(&attr);
+		isSet = false;
+	#endif
+}
+
+Event::~Event() {
+	#ifdef _WIN32
+		CloseHandle(handle);
+	#else
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+	#endif
+}
+
+void Event::set() {
+	#ifdef _WIN32
+		SetEvent(handle);
+	#else
+		pthread_mutex_lock(&mutex);
+		isSet = true;
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&mutex);
+	#endif
+}
+
+bool Event::wait(int timeout) {
+	#ifdef _WIN32
+		return WaitForSingleObject(handle, timeout < 0 ? INFINITE : timeout) == WAIT_OBJECT_0;
+	#else
+		struct timespec deadline;
+		if (timeout >= 0) {
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			deadline.tv_sec += timeout / 1000;
+			deadline.tv_nsec += (timeout % 1000) * 1000000L;
+			if (deadline.tv_nsec >= 1000000000L) {
+				deadline.tv_sec += 1;
+				deadline.tv_nsec -= 1000000000L;
+			}
+		}
+		pthread_mutex_lock(&mutex);
+		while (!isSet) {
+			if (timeout < 0) {
+				pthread_cond_wait(&cond, &mutex);
+			} else if (pthread_cond_timedwait(&cond, &mutex, &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+		bool ret = isSet;
+		isSet = false;
+		pthread_mutex_unlock(&mutex);
+		return ret;
+	#endif
+}
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include "pthread.h"
+#endif
+
+/**
+ * An auto-reset event: one `wait()` consumes one `set()`.
+ */
+class Event {
+
+	public:
+
+		/**
+		 * Signals the event, waking up the thread waiting for it (if any).
+		 */
+		void set();
+
+		/**
+		 * Waits for the event to be signaled.
+		 * @param timeout Maximum number of milliseconds to wait (-1 = forever).
+		 * @return `true` if the event was signaled, `false` on timeout.
+		 */
+		bool wait(int timeout = -1);
+
+		/**
+		 * Constructor.
+		 */
+		Event();
+
+		/**
+		 * Destructor.
+		 */
+		~Event();
+
+	private:
+
+		#ifdef _WIN32
+
+			/**
+			 * Win32 event.
+			 */
+			HANDLE handle;
+		#else
+
+			/**
+			 * UNIX pthread mutex guarding `isSet`.
+			 */
+			pthread_mutex_t mutex;
+
+			/**
+			 * UNIX pthread condition variable.
+			 */
+			pthread_cond_t cond;
+
+			/**
+			 * `true` if the event is signaled, `false` otherwise.
+			 */
+			bool isSet;
+		#endif
+};
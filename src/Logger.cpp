@@ -54,6 +54,7 @@ void Logger::log(int level, char *format, ...) {
 	va_list args;
 	va_start(args, format);
 	int len = vsnprintf(NULL, 0, format, args) + 1;
+	va_end(args);
 	char *msg = (char*) malloc(sizeof(char) * len);
 	if (msg != NULL) {
 		time_t rawtime;
@@ -62,7 +63,9 @@ void Logger::log(int level, char *format, ...) {
 		time(&rawtime);
 		timeinfo = localtime(&rawtime);
 		strftime(timestamp, sizeof(timestamp), "%X", timeinfo);
+		va_start(args, format);
 		vsnprintf(msg, len, format, args);
+		va_end(args);
 		//mutex.lock();
 		if (level >= fileLevel) {
 			FILE *file = fopen(LOG_FILE, "a");
@@ -77,5 +80,4 @@ void Logger::log(int level, char *format, ...) {
 		//mutex.unlock();
 		free(msg);
 	}
-	va_end(args);
 }
@@ -23,6 +23,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cctype>
 #include <cstdio>
 
 #include "sdk/amx/amx.h"
@@ -30,10 +31,18 @@
 
 #include "sql/sql.h"
 #include "sql/SQL_Connection.h"
+#include "sql/SQL_Copy.h"
+#include "sql/SQL_Cursor.h"
+#include "sql/SQL_Dispatcher.h"
+#include "sql/SQL_Executor.h"
 #include "sql/SQL_Pools.h"
+#include "sql/SQL_Prepared.h"
 #include "sql/SQL_ResultSet.h"
 #include "sql/SQL_Statement.h"
+#include "sql/SQL_Store.h"
+#include "sql/SQL_Watchdog.h"
 
+#include "Clock.h"
 #include "Logger.h"
 
 #include "Natives.h"
@@ -75,9 +84,26 @@ cell AMX_NATIVE_CALL Natives::sql_connect(AMX *amx, cell *params) {
 	if (db == NULL) {
 		Logger::log(LOG_WARNING, "Natives::sql_connect: The `db` field is empty.");
 	}
-	Logger::log(LOG_INFO, "Natives::sql_connect: Connecting to database (type = %d) %s:***@%s:%d/%s...", params[1], user, host, params[6], db);
+	int poolSize = 1;
+	if (params[0] >= 7 * 4) {
+		poolSize = params[7];
+		if (poolSize < 1) {
+			Logger::log(LOG_WARNING, "Natives::sql_connect: Invalid pool size (%d), using 1 connection.", poolSize);
+			poolSize = 1;
+		}
+	}
+	Logger::log(LOG_INFO, "Natives::sql_connect: Connecting to database (type = %d, pool_size = %d) %s:***@%s:%d/%s...", params[1], poolSize, user, host, params[6], db);
 	if (conn->connect(host, user, pass, db, params[6])) {
 		Logger::log(LOG_INFO, "Natives::sql_connect: Connection (conn->id = %d) was succesful!", id);
+		for (int i = 1; i < poolSize; ++i) {
+			SQL_Connection *member = SQL_Pools::newConnection(amx, params[1], id);
+			if (member->connect(host, user, pass, db, params[6])) {
+				conn->pool.push_back(member);
+			} else {
+				Logger::log(LOG_WARNING, "Natives::sql_connect: Pool member %d of connection (conn->id = %d) failed! (error = %d, %s)", i, id, member->getErrorId(), member->getError());
+				delete member;
+			}
+		}
 		SQL_Pools::connections[id] = conn;
 		conn->startWorker();
 	} else {
@@ -95,14 +121,52 @@ cell AMX_NATIVE_CALL Natives::sql_disconnect(AMX *amx, cell *params) {
 	if (!SQL_Pools::isValidConnection(params[1])) {
 		return 0;
 	}
+	int timeout = params[0] >= 2 * 4 ? params[2] : -1;
+	if (timeout < 0) {
+		timeout = SQL_Pools::drainTimeout;
+	}
+	// The buffered rows and the dirty rows of the stores are sent before the
+	// connection is drained.
+	SQL_Pools::freeCopies(params[1]);
+	SQL_Pools::freeStores(params[1]);
 	SQL_Connection *conn = SQL_Pools::connections[params[1]];
 	SQL_Pools::connections.erase(params[1]);
-	conn->stopWorker();
-	delete conn;
+	std::vector<SQL_Connection*> conns(1, conn);
+	SQL_Pools::drainConnections(conns, timeout);
+	// The statements are freed first: the watchdog might still use their connection.
+	SQL_Pools::freeStatements(params[1]);
+	SQL_Pools::freeBatches(params[1]);
+	SQL_Pools::freePrepared(params[1]);
+	SQL_Pools::freeCursors(params[1]);
+	SQL_Pools::freeConnection(conn);
 	Logger::log(LOG_INFO, "Natives::sql_disconnect: Connection (conn->id = %d) was destroyed!", params[1]);
 	return 1;
 }
 
+cell AMX_NATIVE_CALL Natives::sql_set_drain_timeout(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (params[1] < 0) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_drain_timeout: Invalid timeout (%d).", params[1]);
+		return 0;
+	}
+	SQL_Pools::drainTimeout = params[1];
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_drain_stats(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	cell *ptr;
+	amx_GetAddr(amx, params[1], &ptr);
+	*ptr = SQL_Pools::lastFlushed;
+	amx_GetAddr(amx, params[2], &ptr);
+	*ptr = SQL_Pools::lastAbandoned;
+	return 1;
+}
+
 cell AMX_NATIVE_CALL Natives::sql_wait(AMX *amx, cell *params) {
 	if (params[0] < 1 * 4) {
 		return 0;
@@ -110,10 +174,271 @@ cell AMX_NATIVE_CALL Natives::sql_wait(AMX *amx, cell *params) {
 	if (!SQL_Pools::isValidConnection(params[1])) {
 		return 0;
 	}
+	int timeout = params[0] >= 2 * 4 ? params[2] : -1;
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	if (conn->hasStreamed()) {
+		// The chunks are delivered by the main thread, which would wait for
+		// them forever.
+		Logger::log(LOG_WARNING, "Natives::sql_wait: Can't wait for a connection with streamed queries pending (conn->id = %d).", params[1]);
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_wait: Waiting for connection (conn->id = %d, timeout = %d)...", params[1], timeout);
+	unsigned long long start = Clock::now();
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		while (conn->pool[i]->pendingCount != 0) {
+			int remaining = -1;
+			if (timeout >= 0) {
+				remaining = timeout - Clock::elapsed(start);
+				if (remaining <= 0) {
+					return 0;
+				}
+			}
+			SQL_Executor::completed.wait(remaining);
+		}
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_await(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidStatement(params[1])) {
+		return 0;
+	}
+	int timeout = params[0] >= 2 * 4 ? params[2] : -1;
+	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
+	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
+		return 0;
+	}
+	if (stmt->status >= STATEMENT_STATUS_EXECUTED) {
+		return 1;
+	}
+	// The statement might be queued behind a streamed one on the same member.
+	if ((stmt->flags & STATEMENT_FLAGS_STREAMED) || ((stmt->conn != NULL) && (stmt->conn->streamedCount != 0))) {
+		Logger::log(LOG_WARNING, "Natives::sql_await: Can't wait for a streamed query or a query queued behind one (stmt->id = %d).", params[1]);
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_await: Waiting for statement (stmt->id = %d, timeout = %d)...", params[1], timeout);
+	unsigned long long start = Clock::now();
+	while (stmt->status < STATEMENT_STATUS_EXECUTED) {
+		int remaining = -1;
+		if (timeout >= 0) {
+			remaining = timeout - Clock::elapsed(start);
+			if (remaining <= 0) {
+				return 0;
+			}
+		}
+		SQL_Executor::completed.wait(remaining);
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_pool_size(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	return SQL_Pools::connections[params[1]]->pool.size();
+}
+
+cell AMX_NATIVE_CALL Natives::sql_pool_queue_depth(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return -1;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return -1;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	if ((params[2] < 0) || (params[2] >= (int) conn->pool.size())) {
+		return -1;
+	}
+	return conn->pool[params[2]]->pendingCount;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_queue_stats(AMX *amx, cell *params) {
+	if (params[0] < 5 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	int lane = SQL_Queue::getLane(params[2]), depth = 0, executed = 0;
+	unsigned long long totalWait = 0, maxWait = 0;
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		SQL_Queue &queue = conn->pool[i]->pending;
+		queue.lock();
+		depth += queue.size(lane);
+		executed += queue.executed[lane];
+		totalWait += queue.totalWait[lane];
+		if (queue.maxWait[lane] > maxWait) {
+			maxWait = queue.maxWait[lane];
+		}
+		queue.unlock();
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_queue_stats: Retrieving queue statistics (conn->id = %d, lane = %d)...", params[1], lane);
+	cell *ptr;
+	amx_GetAddr(amx, params[3], &ptr);
+	*ptr = depth;
+	amx_GetAddr(amx, params[4], &ptr);
+	*ptr = executed == 0 ? 0 : (cell) (totalWait / executed);
+	amx_GetAddr(amx, params[5], &ptr);
+	*ptr = (cell) maxWait;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_tick_budget(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (params[1] < 0) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_tick_budget: Invalid budget (%d).", params[1]);
+		return 0;
+	}
+	Logger::log(LOG_INFO, "Natives::sql_set_tick_budget: Setting the callbacks budget to %d us per tick...", params[1]);
+	SQL_Dispatcher::budget = params[1];
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_tick_stats(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	cell *ptr;
+	amx_GetAddr(amx, params[1], &ptr);
+	*ptr = SQL_Dispatcher::lastDispatched;
+	amx_GetAddr(amx, params[2], &ptr);
+	*ptr = SQL_Dispatcher::lastTime;
+	amx_GetAddr(amx, params[3], &ptr);
+	*ptr = SQL_Dispatcher::backlog;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_queue_limit(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	int policy = params[0] >= 3 * 4 ? params[3] : QUEUE_POLICY_REJECT;
+	if ((params[2] < 0) || (policy < QUEUE_POLICY_REJECT) || (policy > QUEUE_POLICY_BLOCK)) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_queue_limit: Invalid limit (%d) or policy (%d).", params[2], policy);
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	Logger::log(LOG_INFO, "Natives::sql_set_queue_limit: Setting the queue limit to %d (conn->id = %d, policy = %d)...", params[2], conn->id, policy);
+	conn->queueLimit = params[2];
+	conn->queuePolicy = policy;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_batching(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	int delay = params[0] >= 3 * 4 ? params[3] : 0;
+	if ((params[2] < 1) || (params[2] > BATCH_MAX_SIZE) || (delay < 0) || (delay > BATCH_MAX_DELAY)) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_batching: Invalid batch size (%d) or delay (%d).", params[2], delay);
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	Logger::log(LOG_INFO, "Natives::sql_set_batching: Setting the batch size to %d (conn->id = %d, delay = %d)...", params[2], conn->id, delay);
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		conn->pool[i]->batchSize = params[2];
+		conn->pool[i]->batchDelay = delay;
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_async(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	#ifdef _WIN32
+		Logger::log(LOG_WARNING, "Natives::sql_set_async: Asynchronous execution is not supported on Windows.");
+		return 0;
+	#else
+		if (!conn->canExecuteAsync()) {
+			Logger::log(LOG_WARNING, "Natives::sql_set_async: Asynchronous execution is not supported by this connection (conn->id = %d, conn->type = %d).", conn->id, conn->type);
+			return 0;
+		}
+		Logger::log(LOG_INFO, "Natives::sql_set_async: Switching asynchronous execution %s (conn->id = %d)...", params[2] ? "on" : "off", conn->id);
+		for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+			conn->pool[i]->isAsync = params[2] != 0;
+		}
+		return 1;
+	#endif
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_stream_chunk(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	if (params[2] < 1) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_stream_chunk: Invalid chunk size (%d).", params[2]);
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	Logger::log(LOG_INFO, "Natives::sql_set_stream_chunk: Setting the chunk size to %d (conn->id = %d)...", params[2], conn->id);
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		conn->pool[i]->streamChunk = params[2];
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_queue_info(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
 	SQL_Connection *conn = SQL_Pools::connections[params[1]];
-	while (!conn->pending.empty()) {
-		SLEEP(WORKER_TICK_RATE);
+	unsigned long long oldest = conn->getOldestQueued();
+	cell *ptr;
+	amx_GetAddr(amx, params[2], &ptr);
+	*ptr = conn->getQueueDepth();
+	amx_GetAddr(amx, params[3], &ptr);
+	*ptr = oldest == 0 ? 0 : Clock::elapsed(oldest);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_keepalive(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (params[1] < 0) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_keepalive: Invalid idle time (%d).", params[1]);
+		return 0;
 	}
+	SQL_Watchdog::keepAliveIdle = params[1];
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_set_threads(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (params[1] < 1) {
+		Logger::log(LOG_WARNING, "Natives::sql_set_threads: Invalid number of threads (%d).", params[1]);
+		return 0;
+	}
+	Logger::log(LOG_INFO, "Natives::sql_set_threads: Resizing the executor to %d threads...", params[1]);
+	SQL_Executor::resize(params[1]);
 	return 1;
 }
 
@@ -131,7 +456,12 @@ cell AMX_NATIVE_CALL Natives::sql_set_charset(AMX *amx, cell *params) {
 		return false;
 	}
 	Logger::log(LOG_INFO, "Natives::sql_set_charset: Setting conn's charset (conn->id = %d) to %s.", params[1], charset);
-	return SQL_Pools::connections[params[1]]->setCharset(charset);
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	bool ret = true;
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		ret = conn->pool[i]->setCharset(charset) && ret;
+	}
+	return ret;
 }
 
 cell AMX_NATIVE_CALL Natives::sql_get_charset(AMX *amx, cell *params) {
@@ -323,26 +653,61 @@ cell AMX_NATIVE_CALL Natives::sql_format(AMX *amx, cell *params) {
 	return outputLen;
 }
 
-cell AMX_NATIVE_CALL Natives::sql_query(AMX *amx, cell *params) {
-	if (params[0] < 5 * 4) {
-		return 0;
-	}
-	if (!SQL_Pools::isValidConnection(params[1])) {
-		Logger::log(LOG_WARNING, "Natives::sql_query: Invalid connection! (conn->id = %d)", params[1]);
+cell Natives::query(AMX *amx, cell *params, int connectionId, SQL_Prepared *prepared, int first, int timeout, bool hasParams, SQL_Cursor *cursor, SQL_Statement *batch) {
+	if (!SQL_Pools::isValidConnection(connectionId)) {
+		Logger::log(LOG_WARNING, "Natives::query: Invalid connection! (conn->id = %d)", connectionId);
 		return 0;
 	}
-	SQL_Statement *stmt = SQL_Pools::newStatement(amx, params[1]);
+	SQL_Statement *stmt = batch != NULL ? batch : SQL_Pools::newStatement(amx, connectionId);
 	if (stmt == NULL) {
-		Logger::log(LOG_WARNING, "Natives::sql_query: Invalid connection! (conn->id = %d, conn->type = %d)", params[1], SQL_Pools::connections[params[1]]->type);
+		Logger::log(LOG_WARNING, "Natives::query: Invalid connection! (conn->id = %d, conn->type = %d)", connectionId, SQL_Pools::connections[connectionId]->type);
 		return 0;
 	}
 	int id = stmt->id;
-	stmt->connectionId = params[1];
-	amx_GetCString(amx, params[2], stmt->query);
-	stmt->flags = params[3];
-	amx_GetCString(amx, params[4], stmt->callback);
-	amx_GetCString(amx, params[5], stmt->format);
-	for (int i = 0, len = strlen(stmt->format), p = 6; i < len; ++i, ++p) {
+	stmt->connectionId = connectionId;
+	if (batch != NULL) {
+		// The queries were already added to the batch.
+		SQL_Pools::batches.erase(id);
+		appendQuery(stmt->query, "COMMIT");
+	} else if (cursor != NULL) {
+		int len = strlen(cursor->command) + 1;
+		stmt->query = (char*) malloc(sizeof(char) * len);
+		memcpy(stmt->query, cursor->command, len);
+	} else if (prepared == NULL) {
+		amx_GetCString(amx, params[first++], stmt->query);
+	} else {
+		int len = strlen(prepared->query) + 1;
+		stmt->query = (char*) malloc(sizeof(char) * len);
+		memcpy(stmt->query, prepared->query, len);
+		prepared->copyParams(stmt->bindings);
+		stmt->isPrepared = true;
+	}
+	stmt->flags = params[first];
+	if (cursor != NULL) {
+		// The statements of a cursor share a lane, so they are executed in
+		// the order they were sent.
+		stmt->flags = (stmt->flags & ~STATEMENT_FLAGS_PRIORITY_LOW) | STATEMENT_FLAGS_PRIORITY_HIGH;
+	}
+	if (batch != NULL) {
+		// The results of the queries are delivered together; binary results
+		// can't be requested for several commands at once.
+		stmt->flags = (stmt->flags & ~(STATEMENT_FLAGS_STREAMED | STATEMENT_FLAGS_BINARY)) | STATEMENT_FLAGS_TRANSACTION;
+	}
+	if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+		if (stmt->flags & STATEMENT_FLAGS_THREADED) {
+			// The chunks are always cached: the next rows are read while the
+			// script is still processing them.
+			stmt->flags |= STATEMENT_FLAGS_CACHED;
+		} else {
+			// The main thread would wait for itself.
+			Logger::log(LOG_WARNING, "Natives::query: Only threaded queries can be streamed (stmt->id = %d).", id);
+			stmt->flags &= ~STATEMENT_FLAGS_STREAMED;
+		}
+	}
+	amx_GetCString(amx, params[first + 1], stmt->callback);
+	amx_GetCString(amx, params[first + 2], stmt->format);
+	int p = first + (hasParams ? 4 : 3);
+	for (int i = 0, len = strlen(stmt->format); i < len; ++i, ++p) {
 		switch (stmt->format[i]) {
 			case 'a':
 			case 'A':
@@ -370,6 +735,8 @@ cell AMX_NATIVE_CALL Natives::sql_query(AMX *amx, cell *params) {
 				amx_GetAddr(amx, params[p], &ptr);
 				stmt->paramsC.push_back(*ptr);
 				break;
+			case 'k':
+			case 'K':
 			case 'r':
 			case 'R':
 				--p; // We didn't read any parameter.
@@ -385,28 +752,639 @@ cell AMX_NATIVE_CALL Natives::sql_query(AMX *amx, cell *params) {
 				++i; // Skipping next specifier (&x).
 				break;
 			default: 
-				Logger::log(LOG_WARNING, "Natives::sql_query: Format '%c' is not recognized.", stmt->format[i]);
+				Logger::log(LOG_WARNING, "Natives::query: Format '%c' is not recognized.", stmt->format[i]);
 				break;
 		}
 	}
+	if (hasParams) {
+		// The parameters of the query follow the parameters of the callback.
+		char *paramFormat = NULL;
+		amx_GetCString(amx, params[first + 3], paramFormat);
+		for (int i = 0, len = strlen(paramFormat); (i < len) && (p <= params[0] / 4); ++i, ++p) {
+			SQL_Value value;
+			cell *ptr;
+			switch (paramFormat[i]) {
+				case 'd':
+				case 'D':
+				case 'i':
+				case 'I':
+					amx_GetAddr(amx, params[p], &ptr);
+					value.type = VALUE_TYPE_INT;
+					value.i = *ptr;
+					break;
+				case 'f':
+				case 'F':
+					amx_GetAddr(amx, params[p], &ptr);
+					value.type = VALUE_TYPE_FLOAT;
+					value.f = amx_ctof(*ptr);
+					break;
+				case 's':
+				case 'S':
+					value.type = VALUE_TYPE_STRING;
+					amx_GetCString(amx, params[p], value.str);
+					value.len = strlen(value.str) + 1;
+					break;
+				default:
+					Logger::log(LOG_WARNING, "Natives::query: Parameter format '%c' is not recognized.", paramFormat[i]);
+					--p;
+					continue;
+			}
+			stmt->bindings.push_back(value);
+		}
+		free(paramFormat);
+		stmt->isPrepared = true;
+	}
 	SQL_Pools::statements[stmt->id] = stmt;
 	SQL_Connection *conn = SQL_Pools::connections[stmt->connectionId];
+	if (timeout > 0) {
+		SQL_Watchdog::add(stmt, timeout);
+	}
 	if (stmt->flags & STATEMENT_FLAGS_THREADED) {
-		Logger::log(LOG_DEBUG, "Natives::sql_query: Scheduling statement (stmt->id = %d, stmt->query = %s, stmt->callback = %s) for execution...", stmt->id, stmt->query, stmt->callback);
-		conn->pending.push(stmt);
+		Logger::log(LOG_DEBUG, "Natives::query: Scheduling statement (stmt->id = %d, stmt->query = %s, stmt->callback = %s) for execution...", stmt->id, stmt->query, stmt->callback);
+		conn->schedule(stmt, cursor == NULL ? NULL : cursor->member);
 	} else {
-		Logger::log(LOG_DEBUG, "Natives::sql_query: Executing statement (stmt->id = %d, stmt->query = %s)...", stmt->id, stmt->query);
-		conn->executeStatement(stmt);
+		Logger::log(LOG_DEBUG, "Natives::query: Executing statement (stmt->id = %d, stmt->query = %s)...", stmt->id, stmt->query);
+		if (cursor != NULL) {
+			// The threaded statements of the cursor are executed first.
+			while ((cursor->member->pendingCount != 0) && (cursor->member->streamedCount == 0)) {
+				SQL_Executor::completed.wait();
+			}
+			conn = cursor->member;
+		}
+		// The connection is checked out like the executor does, so it isn't
+		// used by a worker or by the keep-alive check at the same time.
+		if (conn->acquire()) {
+			conn->execute(stmt);
+			if (conn->release()) {
+				conn->submit();
+			}
+		} else {
+			Logger::log(LOG_WARNING, "Natives::query: Connection is busy with a streamed query (conn->id = %d, stmt->id = %d).", conn->id, stmt->id);
+			stmt->error = STATEMENT_ERROR_BUSY;
+			stmt->errorMsg = SQL_Statement::getErrorMessage(stmt->error);
+			stmt->status = STATEMENT_STATUS_EXECUTED;
+		}
 		if ((strlen(stmt->callback)) || (stmt->error != 0)) {
-			Logger::log(LOG_DEBUG, "Natives::sql_query: Executing statement callback (stmt->id = %d, stmt->error = %d, stmt->callback = %s)...", stmt->id, stmt->error, stmt->callback);
+			Logger::log(LOG_DEBUG, "Natives::query: Executing statement callback (stmt->id = %d, stmt->error = %d, stmt->callback = %s)...", stmt->id, stmt->error, stmt->callback);
 			stmt->executeCallback();
+			// The result is still valid until the next server tick.
+			SQL_Dispatcher::push(id);
 		} else {
-			Logger::log(LOG_DEBUG, "Natives::sql_query: Statement executed (stmt->id = %d, stmt->error = %d). No callback found!", stmt->id, stmt->error);
+			Logger::log(LOG_DEBUG, "Natives::query: Statement executed (stmt->id = %d, stmt->error = %d). No callback found!", stmt->id, stmt->error);
 		}
 	}
 	return id;
 }
 
+cell AMX_NATIVE_CALL Natives::sql_query(AMX *amx, cell *params) {
+	if (params[0] < 5 * 4) {
+		return 0;
+	}
+	return query(amx, params, params[1], NULL, 2, 0);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_query_timeout(AMX *amx, cell *params) {
+	if (params[0] < 6 * 4) {
+		return 0;
+	}
+	if (params[2] < 0) {
+		Logger::log(LOG_WARNING, "Natives::sql_query_timeout: Invalid timeout (%d).", params[2]);
+		return 0;
+	}
+	return query(amx, params, params[1], NULL, 3, params[2]);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_query_params(AMX *amx, cell *params) {
+	if (params[0] < 6 * 4) {
+		return 0;
+	}
+	return query(amx, params, params[1], NULL, 2, 0, true);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_prepared_stats(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	int hits = 0, misses = 0, evictions = 0;
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		hits += conn->pool[i]->preparedHits;
+		misses += conn->pool[i]->preparedMisses;
+		evictions += conn->pool[i]->preparedEvictions;
+	}
+	cell *ptr;
+	amx_GetAddr(amx, params[2], &ptr);
+	*ptr = hits;
+	amx_GetAddr(amx, params[3], &ptr);
+	*ptr = misses;
+	amx_GetAddr(amx, params[4], &ptr);
+	*ptr = evictions;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_cancel(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidStatement(params[1])) {
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_cancel: Cancelling statement (stmt->id = %d)...", params[1]);
+	return SQL_Watchdog::cancel(SQL_Pools::statements[params[1]], STATEMENT_ERROR_CANCELLED);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_prepare(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		Logger::log(LOG_WARNING, "Natives::sql_prepare: Invalid connection! (conn->id = %d)", params[1]);
+		return 0;
+	}
+	SQL_Prepared *stmt = new SQL_Prepared(SQL_Pools::lastPreparedId++, amx, params[1]);
+	amx_GetCString(amx, params[2], stmt->query);
+	SQL_Pools::prepared[stmt->id] = stmt;
+	Logger::log(LOG_DEBUG, "Natives::sql_prepare: Prepared statement (stmt->id = %d, stmt->query = %s) was created.", stmt->id, stmt->query);
+	return stmt->id;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bind_int(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_INT;
+	value.i = params[3];
+	return SQL_Pools::prepared[params[1]]->bind(params[2], value);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bind_float(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_FLOAT;
+	value.f = amx_ctof(params[3]);
+	return SQL_Pools::prepared[params[1]]->bind(params[2], value);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bind_string(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_STRING;
+	amx_GetCString(amx, params[3], value.str);
+	value.len = strlen(value.str) + 1;
+	bool ret = SQL_Pools::prepared[params[1]]->bind(params[2], value);
+	free(value.str);
+	return ret;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bind_null(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		return 0;
+	}
+	return SQL_Pools::prepared[params[1]]->bind(params[2], SQL_Value());
+}
+
+cell AMX_NATIVE_CALL Natives::sql_execute(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		Logger::log(LOG_WARNING, "Natives::sql_execute: Invalid prepared statement! (stmt->id = %d)", params[1]);
+		return 0;
+	}
+	SQL_Prepared *prepared = SQL_Pools::prepared[params[1]];
+	return query(amx, params, prepared->connectionId, prepared, 2, 0);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_free_statement(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidPrepared(params[1])) {
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_free_statement: Freeing prepared statement (stmt->id = %d)...", params[1]);
+	SQL_Prepared *stmt = SQL_Pools::prepared[params[1]];
+	SQL_Pools::prepared.erase(params[1]);
+	delete stmt;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_cursor_open(AMX *amx, cell *params) {
+	if (params[0] < 5 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	if (!conn->canUseCursors()) {
+		Logger::log(LOG_WARNING, "Natives::sql_cursor_open: Cursors are not supported by this connection (conn->id = %d, conn->type = %d).", conn->id, conn->type);
+		return 0;
+	}
+	// The first member is kept for the other statements.
+	SQL_Connection *member = NULL;
+	for (int i = 1, size = conn->pool.size(); i < size; ++i) {
+		if ((!conn->pool[i]->isPinned) && ((member == NULL) || (conn->pool[i]->pendingCount < member->pendingCount))) {
+			member = conn->pool[i];
+		}
+	}
+	if (member == NULL) {
+		Logger::log(LOG_WARNING, "Natives::sql_cursor_open: There is no free connection in the pool (conn->id = %d, pool_size = %d).", conn->id, (int) conn->pool.size());
+		return 0;
+	}
+	SQL_Cursor *cursor = new SQL_Cursor(SQL_Pools::lastCursorId++, amx, params[1], member);
+	char *query = NULL;
+	amx_GetCString(amx, params[2], query);
+	cursor->declare(query);
+	free(query);
+	Logger::log(LOG_DEBUG, "Natives::sql_cursor_open: Opening cursor (cursor->id = %d, conn->id = %d)...", cursor->id, conn->id);
+	member->isPinned = true;
+	SQL_Pools::cursors[cursor->id] = cursor;
+	Natives::query(amx, params, params[1], NULL, 3, 0, false, cursor);
+	return cursor->id;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_cursor_fetch(AMX *amx, cell *params) {
+	if (params[0] < 5 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidCursor(params[1])) {
+		return 0;
+	}
+	if (params[2] < 1) {
+		Logger::log(LOG_WARNING, "Natives::sql_cursor_fetch: Invalid number of rows (%d).", params[2]);
+		return 0;
+	}
+	SQL_Cursor *cursor = SQL_Pools::cursors[params[1]];
+	cursor->fetch(params[2]);
+	return Natives::query(amx, params, cursor->connectionId, NULL, 3, 0, false, cursor);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_cursor_close(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidCursor(params[1])) {
+		return 0;
+	}
+	SQL_Cursor *cursor = SQL_Pools::cursors[params[1]];
+	SQL_Statement *stmt = SQL_Pools::newStatement(amx, cursor->connectionId);
+	if (stmt == NULL) {
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_cursor_close: Closing cursor (cursor->id = %d)...", params[1]);
+	cursor->close();
+	int len = strlen(cursor->command) + 1;
+	stmt->query = (char*) malloc(sizeof(char) * len);
+	memcpy(stmt->query, cursor->command, len);
+	stmt->callback = (char*) calloc(1, sizeof(char));
+	stmt->format = (char*) calloc(1, sizeof(char));
+	// The member is released once the transaction is over.
+	stmt->flags = STATEMENT_FLAGS_THREADED | STATEMENT_FLAGS_PRIORITY_HIGH | STATEMENT_FLAGS_CLOSES_CURSOR;
+	SQL_Pools::statements[stmt->id] = stmt;
+	SQL_Pools::connections[cursor->connectionId]->schedule(stmt, cursor->member);
+	SQL_Pools::cursors.erase(params[1]);
+	delete cursor;
+	return 1;
+}
+
+cell Natives::beginCopy(AMX *amx, cell *params, int flags, int maxRows, int maxSize, int maxAge) {
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[params[1]];
+	char *table = NULL, *columns = NULL, *callback = NULL;
+	amx_GetCString(amx, params[2], table);
+	if (params[0] >= 3 * 4) {
+		amx_GetCString(amx, params[3], columns);
+	}
+	char *command = flags == STATEMENT_FLAGS_INSERT ? conn->getInsertCommand(table, columns) : conn->getCopyCommand(table, columns);
+	free(table);
+	free(columns);
+	if (command == NULL) {
+		Logger::log(LOG_WARNING, "Natives::beginCopy: Bulk loads are not supported by this connection (conn->id = %d, conn->type = %d).", conn->id, conn->type);
+		return 0;
+	}
+	if (params[0] >= 4 * 4) {
+		amx_GetCString(amx, params[4], callback);
+	}
+	SQL_Copy *copy = new SQL_Copy(SQL_Pools::lastCopyId++, amx, params[1], command, callback);
+	free(callback);
+	if (flags == STATEMENT_FLAGS_INSERT) {
+		// The length of the query is the only limit that matters.
+		copy->flags = flags;
+		copy->maxRows = INSERT_DEFAULT_ROWS;
+		copy->maxSize = 0;
+		copy->maxLength = conn->maxQueryLength;
+	}
+	if (maxRows > 0) {
+		copy->maxRows = maxRows;
+	}
+	if (maxSize > 0) {
+		copy->maxSize = maxSize;
+	}
+	if (maxAge > 0) {
+		copy->maxAge = maxAge;
+	}
+	Logger::log(LOG_DEBUG, "Natives::beginCopy: Starting bulk load (copy->id = %d, conn->id = %d, copy->command = %s)...", copy->id, conn->id, copy->command);
+	SQL_Pools::copies[copy->id] = copy;
+	return copy->id;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_copy_begin(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	int maxSize = params[0] >= 5 * 4 ? params[5] : 0;
+	int maxAge = params[0] >= 6 * 4 ? params[6] : 0;
+	return beginCopy(amx, params, STATEMENT_FLAGS_COPY, 0, maxSize, maxAge);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bulk_begin(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	int maxRows = params[0] >= 5 * 4 ? params[5] : 0;
+	int maxSize = params[0] >= 6 * 4 ? params[6] : 0;
+	int maxAge = params[0] >= 7 * 4 ? params[7] : 0;
+	return beginCopy(amx, params, STATEMENT_FLAGS_COPY, maxRows, maxSize, maxAge);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_insert_batch_create(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	int maxRows = params[0] >= 5 * 4 ? params[5] : 0;
+	int maxAge = params[0] >= 6 * 4 ? params[6] : 0;
+	return beginCopy(amx, params, STATEMENT_FLAGS_INSERT, maxRows, 0, maxAge);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_copy_row(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidCopy(params[1])) {
+		return 0;
+	}
+	SQL_Copy *copy = SQL_Pools::copies[params[1]];
+	char *format = NULL;
+	amx_GetCString(amx, params[2], format);
+	for (int i = 0, len = strlen(format), p = 3; i < len; ++i, ++p) {
+		if ((format[i] != 'n') && (format[i] != 'N') && (p > params[0] / 4)) {
+			Logger::log(LOG_WARNING, "Natives::sql_copy_row: Missing parameter for format '%c' (copy->id = %d).", format[i], copy->id);
+			copy->addField(NULL);
+			continue;
+		}
+		cell *ptr;
+		char tmp[32], *str;
+		switch (format[i]) {
+			case 'd':
+			case 'D':
+			case 'i':
+			case 'I':
+				amx_GetAddr(amx, params[p], &ptr);
+				snprintf(tmp, sizeof(tmp), "%d", (int) *ptr);
+				copy->addField(tmp);
+				break;
+			case 'f':
+			case 'F':
+				amx_GetAddr(amx, params[p], &ptr);
+				snprintf(tmp, sizeof(tmp), "%.9g", amx_ctof(*ptr));
+				copy->addField(tmp);
+				break;
+			case 's':
+			case 'S':
+				str = NULL;
+				amx_GetCString(amx, params[p], str);
+				copy->addField(str);
+				free(str);
+				break;
+			case 'n':
+			case 'N':
+				--p; // We didn't read any parameter.
+				copy->addField(NULL);
+				break;
+			default:
+				Logger::log(LOG_WARNING, "Natives::sql_copy_row: Format '%c' is not recognized.", format[i]);
+				--p;
+				break;
+		}
+	}
+	free(format);
+	copy->endRow();
+	if (copy->isFull()) {
+		copy->flush();
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_bulk_flush(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidCopy(params[1])) {
+		return 0;
+	}
+	return SQL_Pools::copies[params[1]]->flush();
+}
+
+cell AMX_NATIVE_CALL Natives::sql_copy_end(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidCopy(params[1])) {
+		return 0;
+	}
+	SQL_Copy *copy = SQL_Pools::copies[params[1]];
+	Logger::log(LOG_DEBUG, "Natives::sql_copy_end: Ending copy (copy->id = %d)...", copy->id);
+	copy->flush();
+	SQL_Pools::copies.erase(params[1]);
+	delete copy;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_create(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	char *table = NULL, *key = NULL;
+	amx_GetCString(amx, params[2], table);
+	amx_GetCString(amx, params[3], key);
+	bool isUpsert = (params[0] >= 5 * 4) && (params[5] != 0);
+	SQL_Store *store = new SQL_Store(SQL_Pools::lastStoreId++, amx, params[1], table, key, isUpsert);
+	free(table);
+	free(key);
+	if ((params[0] >= 4 * 4) && (params[4] > 0)) {
+		store->interval = params[4];
+	}
+	Logger::log(LOG_DEBUG, "Natives::sql_store_create: Creating store (store->id = %d, conn->id = %d, store->table = %s)...", store->id, params[1], store->table);
+	SQL_Pools::stores[store->id] = store;
+	return store->id;
+}
+
+cell Natives::setStoreValue(AMX *amx, cell *params, const SQL_Value &value) {
+	if (!SQL_Pools::isValidStore(params[1])) {
+		return 0;
+	}
+	char *key = NULL, *column = NULL;
+	amx_GetCString(amx, params[2], key);
+	amx_GetCString(amx, params[3], column);
+	SQL_Pools::stores[params[1]]->set(key, column, value);
+	free(key);
+	free(column);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_set_int(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_INT;
+	value.i = params[4];
+	return setStoreValue(amx, params, value);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_set_float(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_FLOAT;
+	value.f = amx_ctof(params[4]);
+	return setStoreValue(amx, params, value);
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_set_string(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	SQL_Value value;
+	value.type = VALUE_TYPE_STRING;
+	amx_GetCString(amx, params[4], value.str);
+	value.len = strlen(value.str) + 1;
+	cell ret = setStoreValue(amx, params, value);
+	free(value.str);
+	return ret;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_set_null(AMX *amx, cell *params) {
+	if (params[0] < 3 * 4) {
+		return 0;
+	}
+	return setStoreValue(amx, params, SQL_Value());
+}
+
+cell AMX_NATIVE_CALL Natives::sql_store_free(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidStore(params[1])) {
+		return 0;
+	}
+	SQL_Store *store = SQL_Pools::stores[params[1]];
+	store->flush();
+	SQL_Pools::stores.erase(params[1]);
+	delete store;
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_flush(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	int count = 0;
+	for (storesMap_t::iterator it = SQL_Pools::stores.begin(), end = SQL_Pools::stores.end(); it != end; ++it) {
+		if (it->second->connectionId == params[1]) {
+			count += it->second->flush();
+		}
+	}
+	return count;
+}
+
+void Natives::appendQuery(char *&dest, const char *query) {
+	// Trailing separators would add empty commands.
+	int len = strlen(query);
+	while ((len != 0) && ((query[len - 1] == ';') || (isspace((unsigned char) query[len - 1])))) {
+		--len;
+	}
+	int pos = strlen(dest);
+	dest = (char*) realloc(dest, sizeof(char) * (pos + len + 3));
+	// The line break ends a `--` comment the previous query might end with.
+	memcpy(&dest[pos], ";\n", 2);
+	memcpy(&dest[pos + 2], query, len);
+	dest[pos + len + 2] = '\0';
+}
+
+cell AMX_NATIVE_CALL Natives::sql_batch_begin(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidConnection(params[1])) {
+		return 0;
+	}
+	SQL_Statement *stmt = SQL_Pools::newStatement(amx, params[1]);
+	if (stmt == NULL) {
+		return 0;
+	}
+	stmt->query = (char*) malloc(sizeof(char) * 6);
+	strcpy(stmt->query, "BEGIN");
+	Logger::log(LOG_DEBUG, "Natives::sql_batch_begin: Beginning batch (stmt->id = %d, conn->id = %d)...", stmt->id, params[1]);
+	SQL_Pools::batches[stmt->id] = stmt;
+	return stmt->id;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_batch_add(AMX *amx, cell *params) {
+	if (params[0] < 2 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidBatch(params[1])) {
+		return 0;
+	}
+	char *query = NULL;
+	amx_GetCString(amx, params[2], query);
+	appendQuery(SQL_Pools::batches[params[1]]->query, query);
+	free(query);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL Natives::sql_batch_commit(AMX *amx, cell *params) {
+	if (params[0] < 4 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidBatch(params[1])) {
+		return 0;
+	}
+	SQL_Statement *batch = SQL_Pools::batches[params[1]];
+	return query(amx, params, batch->connectionId, NULL, 2, 0, false, NULL, batch);
+}
+
 cell AMX_NATIVE_CALL Natives::sql_free_result(AMX *amx, cell *params) {
 	if (params[0] < 1 * 4) {
 		return 0;
@@ -415,7 +1393,12 @@ cell AMX_NATIVE_CALL Natives::sql_free_result(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
+		return 0;
+	}
+	if (stmt->chunkState == CHUNK_STATE_DELIVERING) {
+		// The rest of the result is still being read.
+		Logger::log(LOG_WARNING, "Natives::sql_free_result: Only the final chunk of a streamed result can be freed (stmt->id = %d).", params[1]);
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_free_result: Freeing statement (stmt->id = %d)...", params[1]);
@@ -432,7 +1415,12 @@ cell AMX_NATIVE_CALL Natives::sql_store_result(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
+		return 0;
+	}
+	if (stmt->chunkState == CHUNK_STATE_DELIVERING) {
+		// The rest of the result is still being read.
+		Logger::log(LOG_WARNING, "Natives::sql_store_result: Only the final chunk of a streamed result can be stored (stmt->id = %d).", params[1]);
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_store_result: Storing statement (stmt->id = %d)...", params[1]);
@@ -442,6 +1430,20 @@ cell AMX_NATIVE_CALL Natives::sql_store_result(AMX *amx, cell *params) {
 	return 1;
 }
 
+cell AMX_NATIVE_CALL Natives::sql_is_last_chunk(AMX *amx, cell *params) {
+	if (params[0] < 1 * 4) {
+		return 0;
+	}
+	if (!SQL_Pools::isValidStatement(params[1])) {
+		return 0;
+	}
+	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
+		return 0;
+	}
+	return stmt->chunkState != CHUNK_STATE_DELIVERING;
+}
+
 cell AMX_NATIVE_CALL Natives::sql_insert_id(AMX *amx, cell *params) {
 	if (params[0] < 1 * 4) {
 		return 0;
@@ -450,7 +1452,8 @@ cell AMX_NATIVE_CALL Natives::sql_insert_id(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	// Statements that failed before being executed have no results.
+	if ((stmt->status < STATEMENT_STATUS_EXECUTED) || (stmt->resultSets.empty())) {
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_insert_id: Retrieving insert ID (stmt->id = %d)...", params[1]);
@@ -465,7 +1468,7 @@ cell AMX_NATIVE_CALL Natives::sql_affected_rows(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if ((stmt->status < STATEMENT_STATUS_EXECUTED) || (stmt->resultSets.empty())) {
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_affected_rows: Retrieving the count of affected rows (stmt->id = %d)...", params[1]);
@@ -480,7 +1483,7 @@ cell AMX_NATIVE_CALL Natives::sql_error(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_error: Retrieving error code (stmt->id = %d)...", params[1]);
@@ -495,7 +1498,7 @@ cell AMX_NATIVE_CALL Natives::sql_error_string(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -524,7 +1527,7 @@ cell AMX_NATIVE_CALL Natives::sql_num_rows(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if ((stmt->status < STATEMENT_STATUS_EXECUTED) || (stmt->resultSets.empty())) {
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_num_rows: Retrieving the count of rows (stmt->id = %d)...", params[1]);
@@ -539,7 +1542,7 @@ cell AMX_NATIVE_CALL Natives::sql_num_fields(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if ((stmt->status < STATEMENT_STATUS_EXECUTED) || (stmt->resultSets.empty())) {
 		return 0;
 	}
 	Logger::log(LOG_DEBUG, "Natives::sql_num_fields: Retrieving the count of fields (stmt->id = %d)...", params[1]);
@@ -554,7 +1557,7 @@ cell AMX_NATIVE_CALL Natives::sql_next_result(AMX *amx, cell* params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -572,7 +1575,7 @@ cell AMX_NATIVE_CALL Natives::sql_field_name(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -605,7 +1608,7 @@ cell AMX_NATIVE_CALL Natives::sql_fetch_row(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if ((stmt->status < STATEMENT_STATUS_EXECUTED) || (stmt->resultSets.empty())) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -649,7 +1652,7 @@ cell AMX_NATIVE_CALL Natives::sql_next_row(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -678,7 +1681,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -726,7 +1729,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_assoc(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -777,7 +1780,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_int(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -787,15 +1790,8 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_int(AMX *amx, cell *params) {
 	if (row != -1) {
 		conn->seekRow(stmt, row);
 	}
-	char *tmp = NULL;
-	int len, val = 0;
-	bool isCopy = conn->fetchNum(stmt, fieldidx, tmp, len);
-	if (len != 0) {
-		val = atoi(tmp);
-		if (isCopy) {
-			free(tmp);
-		}
-	} else {
+	int val = 0;
+	if (!conn->fetchInt(stmt, fieldidx, val)) {
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_int: Can't find field %d or result is empty.", fieldidx);
 	}
 	return val;
@@ -816,7 +1812,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_assoc_int(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -832,15 +1828,8 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_assoc_int(AMX *amx, cell *params) {
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_assoc: Field name is empty.");
 		return 0;
 	}
-	char *tmp = NULL;
-	int len, val = 0;
-	bool isCopy = conn->fetchAssoc(stmt, fieldname, tmp, len);
-	if (len != 0) {
-		val = atoi(tmp);
-		if (isCopy) {
-			free(tmp);
-		}
-	} else {
+	int val = 0;
+	if (!conn->fetchInt(stmt, conn->findField(stmt, fieldname), val)) {
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_assoc_int: Can't find field %s or result is empty.", fieldname);
 	}
 	return val;
@@ -861,7 +1850,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_float(AMX *amx, cell *params) {
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -871,16 +1860,8 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_float(AMX *amx, cell *params) {
 	if (row != -1) {
 		conn->seekRow(stmt, row);
 	}
-	int len;
-	char *tmp = NULL;
-	bool isCopy = conn->fetchNum(stmt, fieldidx, tmp, len);
 	float val = 0.0;
-	if (len != 0) {
-		val = (float) atof(tmp);
-		if (isCopy) {
-			free(tmp);
-		}
-	} else {
+	if (!conn->fetchFloat(stmt, fieldidx, val)) {
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_int: Can't find field %d or result is empty.", fieldidx);
 	}
 	return amx_ftoc(val);
@@ -901,7 +1882,7 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_assoc_float(AMX *amx, cell *params)
 		return 0;
 	}
 	SQL_Statement *stmt = SQL_Pools::statements[params[1]];
-	if (stmt->status == STATEMENT_STATUS_NONE) {
+	if (stmt->status < STATEMENT_STATUS_EXECUTED) {
 		return 0;
 	}
 	if (!SQL_Pools::isValidConnection(stmt->connectionId)) {
@@ -917,16 +1898,8 @@ cell AMX_NATIVE_CALL Natives::sql_get_field_assoc_float(AMX *amx, cell *params)
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_assoc: Field name is empty.");
 		return 0;
 	}
-	char *tmp = NULL;
-	int len;
-	bool isCopy = conn->fetchAssoc(stmt, fieldname, tmp, len);
 	float val = 0.0;
-	if (len != 0) {
-		val = (float) atof(tmp);
-		if (isCopy) {
-			free(tmp);
-		}
-	} else {
+	if (!conn->fetchFloat(stmt, conn->findField(stmt, fieldname), val)) {
 		Logger::log(LOG_WARNING, "Natives::sql_get_field_assoc_int: Can't find field %s or result is empty.", fieldname);
 	}
 	return amx_ftoc(val);
@@ -27,6 +27,11 @@
 
 #include "sdk/amx/amx.h"
 
+class SQL_Cursor;
+class SQL_Prepared;
+class SQL_Statement;
+struct SQL_Value;
+
 class Natives {
 
 	/**
@@ -36,7 +41,22 @@ class Natives {
 		static cell AMX_NATIVE_CALL sql_debug(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_connect(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_disconnect(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_drain_timeout(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_drain_stats(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_wait(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_await(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_pool_size(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_pool_queue_depth(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_queue_stats(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_queue_limit(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_batching(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_async(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_stream_chunk(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_queue_info(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_keepalive(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_threads(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_set_tick_budget(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_tick_stats(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_set_charset(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_get_charset(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_ping(AMX *amx, cell *params);
@@ -44,8 +64,39 @@ class Natives {
 		static cell AMX_NATIVE_CALL sql_escape_string(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_format(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_query(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_query_timeout(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_query_params(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_prepared_stats(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_cancel(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_prepare(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bind_int(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bind_float(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bind_string(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bind_null(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_execute(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_free_statement(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_cursor_open(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_cursor_fetch(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_cursor_close(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_copy_begin(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_copy_row(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_copy_end(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bulk_begin(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_bulk_flush(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_insert_batch_create(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_create(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_set_int(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_set_float(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_set_string(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_set_null(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_store_free(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_flush(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_batch_begin(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_batch_add(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_batch_commit(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_free_result(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_store_result(AMX *amx, cell *params);
+		static cell AMX_NATIVE_CALL sql_is_last_chunk(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_insert_id(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_affected_rows(AMX *amx, cell *params);
 		static cell AMX_NATIVE_CALL sql_error(AMX *amx, cell *params);
@@ -68,6 +119,54 @@ class Natives {
 	 */
 	private:
 		
+		/**
+		 * Creates and executes (or schedules) a statement. The parameters of
+		 * the query start at `params[first]` (with the query itself, unless
+		 * the statement is prepared or belongs to a cursor).
+		 * @param amx
+		 * @param params
+		 * @param connectionId
+		 * @param prepared The prepared statement to execute (or NULL).
+		 * @param first
+		 * @param timeout Milliseconds (0 = no limit).
+		 * @param hasParams Whether the parameters of the callback are
+		 *        followed by parameters of the query (sent separately).
+		 * @param cursor The cursor whose command is executed (or NULL).
+		 * @param batch The batch that is committed (or NULL).
+		 * @return The ID of the statement.
+		 */
+		static cell query(AMX *amx, cell *params, int connectionId, SQL_Prepared *prepared, int first, int timeout, bool hasParams = false, SQL_Cursor *cursor = NULL, SQL_Statement *batch = NULL);
+		
+		/**
+		 * Appends a query to the queries of a batch.
+		 * @param dest
+		 * @param query
+		 */
+		static void appendQuery(char *&dest, const char *query);
+		
+		/**
+		 * Starts a bulk load or an insert batch. The handle, the table, the
+		 * columns and the callback are read from `params[1..4]`.
+		 * @param amx
+		 * @param params
+		 * @param flags `STATEMENT_FLAGS_COPY` or `STATEMENT_FLAGS_INSERT`.
+		 * @param maxRows The limits that trigger a flush (0 = default).
+		 * @param maxSize
+		 * @param maxAge
+		 * @return The ID of the copy.
+		 */
+		static cell beginCopy(AMX *amx, cell *params, int flags, int maxRows, int maxSize, int maxAge);
+		
+		/**
+		 * Sets a column of a row of a store. The store, the key and the
+		 * column are read from `params[1..3]`.
+		 * @param amx
+		 * @param params
+		 * @param value
+		 * @return
+		 */
+		static cell setStoreValue(AMX *amx, cell *params, const SQL_Value &value);
+		
 		/**
 		 * Constructor.
 		 */
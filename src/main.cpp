@@ -25,8 +25,16 @@
 
 #include "sql/sql.h"
 #include "sql/SQL_Connection.h"
+#include "sql/SQL_Dispatcher.h"
+#include "sql/SQL_Executor.h"
 #include "sql/SQL_Statement.h"
 #include "sql/SQL_Pools.h"
+#include "sql/SQL_Copy.h"
+#include "sql/SQL_Cursor.h"
+#include "sql/SQL_Prepared.h"
+#include "sql/SQL_Reactor.h"
+#include "sql/SQL_Store.h"
+#include "sql/SQL_Watchdog.h"
 
 #if defined PLUGIN_SUPPORTS_MYSQL
 	#include "sql/mysql/mysql.h"
@@ -47,7 +55,22 @@ const AMX_NATIVE_INFO NATIVES[] = {
 	{"sql_debug", Natives::sql_debug},
 	{"sql_connect", Natives::sql_connect},
 	{"sql_disconnect", Natives::sql_disconnect},
+	{"sql_set_drain_timeout", Natives::sql_set_drain_timeout},
+	{"sql_drain_stats", Natives::sql_drain_stats},
 	{"sql_wait", Natives::sql_wait},
+	{"sql_await", Natives::sql_await},
+	{"sql_pool_size", Natives::sql_pool_size},
+	{"sql_pool_queue_depth", Natives::sql_pool_queue_depth},
+	{"sql_queue_stats", Natives::sql_queue_stats},
+	{"sql_set_queue_limit", Natives::sql_set_queue_limit},
+	{"sql_set_batching", Natives::sql_set_batching},
+	{"sql_set_async", Natives::sql_set_async},
+	{"sql_set_stream_chunk", Natives::sql_set_stream_chunk},
+	{"sql_queue_info", Natives::sql_queue_info},
+	{"sql_set_keepalive", Natives::sql_set_keepalive},
+	{"sql_set_threads", Natives::sql_set_threads},
+	{"sql_set_tick_budget", Natives::sql_set_tick_budget},
+	{"sql_tick_stats", Natives::sql_tick_stats},
 	{"sql_set_charset", Natives::sql_set_charset},
 	{"sql_get_charset", Natives::sql_get_charset},
 	{"sql_ping", Natives::sql_ping},
@@ -55,7 +78,43 @@ const AMX_NATIVE_INFO NATIVES[] = {
 	{"sql_escape_string", Natives::sql_escape_string},
 	{"sql_format", Natives::sql_format},
 	{"sql_query", Natives::sql_query},
+	{"sql_query_timeout", Natives::sql_query_timeout},
+	{"sql_query_params", Natives::sql_query_params},
+	{"sql_prepared_stats", Natives::sql_prepared_stats},
+	{"sql_cancel", Natives::sql_cancel},
 	{"sql_store_result", Natives::sql_store_result},
+	{"sql_is_last_chunk", Natives::sql_is_last_chunk},
+	{"sql_prepare", Natives::sql_prepare},
+	{"sql_bind_int", Natives::sql_bind_int},
+	{"sql_bind_float", Natives::sql_bind_float},
+	{"sql_bind_string", Natives::sql_bind_string},
+	{"sql_bind_null", Natives::sql_bind_null},
+	{"sql_execute", Natives::sql_execute},
+	{"sql_free_statement", Natives::sql_free_statement},
+	{"sql_cursor_open", Natives::sql_cursor_open},
+	{"sql_cursor_fetch", Natives::sql_cursor_fetch},
+	{"sql_cursor_close", Natives::sql_cursor_close},
+	{"sql_copy_begin", Natives::sql_copy_begin},
+	{"sql_copy_row", Natives::sql_copy_row},
+	{"sql_copy_end", Natives::sql_copy_end},
+	{"sql_bulk_begin", Natives::sql_bulk_begin},
+	{"sql_bulk_row", Natives::sql_copy_row},
+	{"sql_bulk_flush", Natives::sql_bulk_flush},
+	{"sql_bulk_end", Natives::sql_copy_end},
+	{"sql_insert_batch_create", Natives::sql_insert_batch_create},
+	{"sql_insert_batch_add", Natives::sql_copy_row},
+	{"sql_insert_batch_flush", Natives::sql_bulk_flush},
+	{"sql_insert_batch_free", Natives::sql_copy_end},
+	{"sql_store_create", Natives::sql_store_create},
+	{"sql_store_set_int", Natives::sql_store_set_int},
+	{"sql_store_set_float", Natives::sql_store_set_float},
+	{"sql_store_set_string", Natives::sql_store_set_string},
+	{"sql_store_set_null", Natives::sql_store_set_null},
+	{"sql_store_free", Natives::sql_store_free},
+	{"sql_flush", Natives::sql_flush},
+	{"sql_batch_begin", Natives::sql_batch_begin},
+	{"sql_batch_add", Natives::sql_batch_add},
+	{"sql_batch_commit", Natives::sql_batch_commit},
 	{"sql_free_result", Natives::sql_free_result},
 	{"sql_insert_id", Natives::sql_insert_id},
 	{"sql_affected_rows", Natives::sql_affected_rows},
@@ -98,6 +157,11 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData) {
 			return false;
 		}
 	#endif
+	SQL_Executor::start(EXECUTOR_DEFAULT_THREADS);
+	SQL_Watchdog::start();
+	#ifndef _WIN32
+		SQL_Reactor::start();
+	#endif
 	Logger::logprintf("  >> SQL plugin " PLUGIN_VERSION " successfully loaded.");
 	#ifdef PLUGIN_SUPPORTS_MYSQL
 		Logger::logprintf("      + MySQL support is enabled.");
@@ -105,6 +169,9 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData) {
 	#ifdef PLUGIN_SUPPORTS_PGSQL
 		Logger::logprintf("      + PostgreSQL support is enabled.");
 	#endif
+	#ifdef PLUGIN_SUPPORTS_SQLITE
+		Logger::logprintf("      + SQLite support is enabled.");
+	#endif
 	return true;
 }
 
@@ -113,15 +180,37 @@ PLUGIN_EXPORT int PLUGIN_CALL AmxLoad(AMX *amx) {
 }
 
 PLUGIN_EXPORT int PLUGIN_CALL AmxUnload(AMX *amx) {
-	for (connectionsMap_t::iterator it = SQL_Pools::connections.begin(), next = it, end = SQL_Pools::connections.end(); it != end; it = next) {
+	// The buffered rows and the dirty rows of the stores are sent before the
+	// connections are drained.
+	for (copiesMap_t::iterator it = SQL_Pools::copies.begin(), next = it, end = SQL_Pools::copies.end(); it != end; it = next) {
 		++next;
-		SQL_Connection *conn = it->second;
-		if (conn->amx == amx) {
-			SQL_Pools::connections.erase(it);
-			conn->stopWorker();
-			delete conn;
+		SQL_Copy *copy = it->second;
+		if (copy->amx == amx) {
+			copy->flush();
+			SQL_Pools::copies.erase(it);
+			delete copy;
+		}
+	}
+	for (storesMap_t::iterator it = SQL_Pools::stores.begin(), next = it, end = SQL_Pools::stores.end(); it != end; it = next) {
+		++next;
+		SQL_Store *store = it->second;
+		if (store->amx == amx) {
+			store->flush();
+			SQL_Pools::stores.erase(it);
+			delete store;
+		}
+	}
+	// The connections of this script are drained together, so their queued
+	// statements (e.g. saves on exit) are not lost.
+	std::vector<SQL_Connection*> conns;
+	for (connectionsMap_t::iterator it = SQL_Pools::connections.begin(), end = SQL_Pools::connections.end(); it != end; ++it) {
+		if (it->second->amx == amx) {
+			conns.push_back(it->second);
 		}
 	}
+	SQL_Pools::drainConnections(conns, SQL_Pools::drainTimeout);
+	// Statements are freed before their connections (they might still be
+	// watched by the watchdog, which uses their connection).
 	for (statementsMap_t::iterator it = SQL_Pools::statements.begin(), next = it, end = SQL_Pools::statements.end(); it != end; it = next) {
 		++next;
 		SQL_Statement *stmt = it->second;
@@ -130,10 +219,48 @@ PLUGIN_EXPORT int PLUGIN_CALL AmxUnload(AMX *amx) {
 			delete stmt;
 		}
 	}
+	for (statementsMap_t::iterator it = SQL_Pools::batches.begin(), next = it, end = SQL_Pools::batches.end(); it != end; it = next) {
+		++next;
+		SQL_Statement *stmt = it->second;
+		if (stmt->amx == amx) {
+			SQL_Pools::batches.erase(it);
+			delete stmt;
+		}
+	}
+	for (preparedMap_t::iterator it = SQL_Pools::prepared.begin(), next = it, end = SQL_Pools::prepared.end(); it != end; it = next) {
+		++next;
+		SQL_Prepared *stmt = it->second;
+		if (stmt->amx == amx) {
+			SQL_Pools::prepared.erase(it);
+			delete stmt;
+		}
+	}
+	for (cursorsMap_t::iterator it = SQL_Pools::cursors.begin(), next = it, end = SQL_Pools::cursors.end(); it != end; it = next) {
+		++next;
+		SQL_Cursor *cursor = it->second;
+		if (cursor->amx == amx) {
+			SQL_Pools::cursors.erase(it);
+			delete cursor;
+		}
+	}
+	for (connectionsMap_t::iterator it = SQL_Pools::connections.begin(), next = it, end = SQL_Pools::connections.end(); it != end; it = next) {
+		++next;
+		SQL_Connection *conn = it->second;
+		if (conn->amx == amx) {
+			SQL_Pools::connections.erase(it);
+			SQL_Pools::freeConnection(conn);
+		}
+	}
 	return AMX_ERR_NONE;
 }
 
 PLUGIN_EXPORT void PLUGIN_CALL Unload() {
+	SQL_Watchdog::stop();
+	#ifndef _WIN32
+		SQL_Reactor::stop();
+	#endif
+	SQL_Executor::stop();
+	SQL_Pools::reapConnections();
 	#ifdef PLUGIN_SUPPORTS_MYSQL
 		mysql_library_end();
 	#endif
@@ -141,21 +268,8 @@ PLUGIN_EXPORT void PLUGIN_CALL Unload() {
 }
 
 PLUGIN_EXPORT void PLUGIN_CALL ProcessTick() {
-	for (statementsMap_t::iterator it = SQL_Pools::statements.begin(), next = it, end = SQL_Pools::statements.end(); it != end; it = next) {
-		++next;
-		SQL_Statement *stmt = it->second;
-		if ((stmt->flags & STATEMENT_FLAGS_THREADED) && (stmt->status == STATEMENT_STATUS_EXECUTED)) {
-			Logger::log(LOG_DEBUG, "ProccessTick: Executing query callback (stmt->id = %d, stmt->error = %d, stmt->callback = %s)...", stmt->id, stmt->error, stmt->callback);
-			int id = stmt->id;
-			stmt->executeCallback();
-			if (!SQL_Pools::isValidStatement(id)) {
-				continue;
-			}
-		}
-		if ((!SQL_Pools::isValidConnection(stmt->connectionId)) || (stmt->status == STATEMENT_STATUS_PROCESSED)) {
-			Logger::log(LOG_DEBUG, "ProccessTick: Erasing query (stmt->id = %d)...", stmt->id);
-			SQL_Pools::statements.erase(it);
-			delete stmt;
-		}
-	}
+	SQL_Pools::flushCopies();
+	SQL_Pools::flushStores();
+	SQL_Pools::reapConnections();
+	SQL_Dispatcher::tick();
 }
@@ -23,83 +23,671 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../Clock.h"
 #include "../Logger.h"
 
+#include "SQL_ResultSet.h"
 #include "SQL_Statement.h"
 
-#if defined PLUGIN_SUPPORTS_MYSQL
-	#include "mysql/mysql.h"
-#endif
+#include "SQL_Connection.h"
+#include "SQL_Dispatcher.h"
+#include "SQL_Executor.h"
+#include "SQL_Reactor.h"
+#include "SQL_Watchdog.h"
 
-#if defined PLUGIN_SUPPORTS_PGSQL
-	#include "pgsql/pgsql.h"
-#endif
+SQL_Connection::SQL_Connection(int id, AMX *amx) : state(CONNECTION_STATE_IDLE), pendingCount(0), streamedCount(0) {
+	this->id = id;
+	this->amx = amx;
+	isActive = false;
+	lastActivity = Clock::now();
+	preparedHits = 0;
+	preparedMisses = 0;
+	preparedEvictions = 0;
+	queueLimit = 0;
+	queuePolicy = QUEUE_POLICY_REJECT;
+	batchSize = 1;
+	batchDelay = 0;
+	isAsync = false;
+	streamChunk = STREAM_DEFAULT_CHUNK;
+	maxQueryLength = INSERT_MAX_LENGTH;
+	isPinned = false;
+	runner = NULL;
+	handoff = NULL;
+	filling = NULL;
+	executing = NULL;
+	pool.push_back(this);
+}
 
-#include "SQL_Connection.h"
+SQL_Connection::~SQL_Connection() {
+	SQL_Watchdog::unwatch(this);
+	stopWorker();
+	for (int i = 1, size = pool.size(); i < size; ++i) {
+		delete pool[i];
+	}
+}
 
-#ifdef _WIN32
-DWORD WINAPI SQL_Worker(LPVOID param) {
-#else
-void *SQL_Worker(void *param) {
-#endif
-	SQL_Connection* conn = (SQL_Connection*) param;
-	#if defined PLUGIN_SUPPORTS_MYSQL
-		if (conn->type == PLUGIN_SUPPORTS_MYSQL) {
-			mysql_thread_init();
+void SQL_Connection::startWorker() {
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		pool[i]->isActive = true;
+		SQL_Watchdog::watch(pool[i]);
+	}
+}
+
+void SQL_Connection::stopWorker() {
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		pool[i]->isActive = false;
+	}
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		while (pool[i]->state != CONNECTION_STATE_IDLE) {
+			SLEEP(1);
 		}
-	#endif
-	while (conn->isActive) {
-		SQL_Statement *stmt = NULL;
-		while (conn->pending.pop(stmt)) {
-			Logger::log(LOG_DEBUG, "SQL_Worker[%d]: Executing query (stmt->id = %d, stmt->query = %s)...", conn->id, stmt->id, stmt->query);
-			conn->executeStatement(stmt);
+	}
+}
+
+void SQL_Connection::schedule(SQL_Statement *stmt, SQL_Connection *member) {
+	if (member == NULL) {
+		if ((queueLimit != 0) && (getQueueDepth() >= queueLimit) && (!makeRoom(stmt))) {
+			Logger::log(LOG_WARNING, "SQL_Connection::schedule: Queue is full, statement rejected (conn->id = %d, stmt->id = %d).", id, stmt->id);
+			stmt->fail(STATEMENT_ERROR_QUEUE_FULL);
+			return;
+		}
+		// The first member is never held by a cursor.
+		member = this;
+		for (int i = 1, size = pool.size(); i < size; ++i) {
+			if ((!pool[i]->isPinned) && (pool[i]->pendingCount < member->pendingCount)) {
+				member = pool[i];
+			}
+		}
+	}
+	stmt->queuedAt = Clock::now();
+	stmt->status = STATEMENT_STATUS_QUEUED;
+	member->enqueue(stmt);
+}
+
+void SQL_Connection::enqueue(SQL_Statement *stmt) {
+	stmt->conn = this;
+	++pendingCount;
+	if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+		++streamedCount;
+	}
+	pending.push(stmt);
+	if (wake()) {
+		submit();
+	} else {
+		Event *doorbell = filling;
+		if (doorbell != NULL) {
+			doorbell->set();
+		}
+	}
+}
+
+int SQL_Connection::rebalance() {
+	int moved = 0;
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		SQL_Connection *member = pool[i];
+		if ((member->isPinned) || (member->state != CONNECTION_STATE_IDLE)) {
+			continue;
+		}
+		for (int j = 0; j != size; ++j) {
+			SQL_Connection *busy = pool[j];
+			if ((busy->isPinned) || (busy->state == CONNECTION_STATE_IDLE)) {
+				continue;
+			}
+			// The statements keep their queue time, so they don't get more
+			// time from the watchdog.
+			SQL_Statement *stmt;
+			while ((member->pendingCount < busy->pending.size()) && (busy->pending.steal(stmt))) {
+				if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+					--busy->streamedCount;
+				}
+				--busy->pendingCount;
+				member->enqueue(stmt);
+				++moved;
+			}
+		}
+	}
+	return moved;
+}
+
+bool SQL_Connection::makeRoom(SQL_Statement *stmt) {
+	switch (queuePolicy) {
+		case QUEUE_POLICY_DROP_OLDEST: {
+			int lane = SQL_Queue::getLane(stmt->flags);
+			for (int i = 0, size = pool.size(); i != size; ++i) {
+				SQL_Statement *victim;
+				// The statements of a cursor are never dropped.
+				if ((!pool[i]->isPinned) && (pool[i]->pending.popOldest(victim, lane))) {
+					Logger::log(LOG_WARNING, "SQL_Connection::makeRoom: Queue is full, statement dropped (conn->id = %d, stmt->id = %d).", id, victim->id);
+					if (victim->flags & STATEMENT_FLAGS_STREAMED) {
+						--pool[i]->streamedCount;
+					}
+					victim->fail(STATEMENT_ERROR_QUEUE_FULL);
+					--pool[i]->pendingCount;
+					return true;
+				}
+			}
+			return false;
+		}
+		case QUEUE_POLICY_BLOCK: {
+			Logger::log(LOG_DEBUG, "SQL_Connection::makeRoom: Queue is full, waiting (conn->id = %d)...", id);
+			unsigned long long start = Clock::now();
+			while ((isActive) && (getQueueDepth() >= queueLimit)) {
+				// Streamed statements wait for the main thread to take their
+				// chunks, so the queue wouldn't move. The wait is bounded in
+				// case the server stops answering.
+				int remaining = QUEUE_BLOCK_TIMEOUT - Clock::elapsed(start);
+				if ((remaining <= 0) || (hasStreamed())) {
+					return false;
+				}
+				SQL_Executor::completed.wait(remaining);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SQL_Connection::hasStreamed() {
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		if (pool[i]->streamedCount != 0) {
+			return true;
 		}
-		SLEEP(WORKER_TICK_RATE);
 	}
-	#if defined PLUGIN_SUPPORTS_MYSQL
-		if (conn->type == PLUGIN_SUPPORTS_MYSQL) {
-			mysql_thread_end();
+	return false;
+}
+
+int SQL_Connection::getQueueDepth() {
+	int depth = 0;
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		depth += pool[i]->pending.size();
+	}
+	return depth;
+}
+
+unsigned long long SQL_Connection::getOldestQueued() {
+	unsigned long long ret = 0;
+	for (int i = 0, size = pool.size(); i != size; ++i) {
+		unsigned long long oldest = pool[i]->pending.oldest();
+		if ((oldest != 0) && ((ret == 0) || (oldest < ret))) {
+			ret = oldest;
+		}
+	}
+	return ret;
+}
+
+bool SQL_Connection::wake() {
+	for (;;) {
+		int current = state, next;
+		if (current == CONNECTION_STATE_IDLE) {
+			next = CONNECTION_STATE_SCHEDULED;
+		} else if (current == CONNECTION_STATE_RUNNING) {
+			// The executor is running this connection and might have already
+			// found the queue empty; it will submit the connection again.
+			next = CONNECTION_STATE_DIRTY;
+		} else {
+			return false;
+		}
+		if (state.compare_exchange_strong(current, next)) {
+			return next == CONNECTION_STATE_SCHEDULED;
+		}
+	}
+}
+
+bool SQL_Connection::acquire() {
+	for (;;) {
+		int expected = CONNECTION_STATE_IDLE;
+		if (state.compare_exchange_strong(expected, CONNECTION_STATE_RUNNING)) {
+			return true;
+		}
+		if (streamedCount != 0) {
+			return false;
+		}
+		// The connection is released right after the last statement is
+		// signaled, so the wait is short.
+		SQL_Executor::completed.wait(1);
+	}
+}
+
+bool SQL_Connection::release() {
+	if ((isActive) && (!pending.empty())) {
+		state = CONNECTION_STATE_SCHEDULED;
+		return true;
+	}
+	int current = CONNECTION_STATE_RUNNING;
+	if ((!isActive) || (state.compare_exchange_strong(current, CONNECTION_STATE_IDLE))) {
+		state = CONNECTION_STATE_IDLE;
+		return false;
+	}
+	state = CONNECTION_STATE_SCHEDULED;
+	return true;
+}
+
+void SQL_Connection::submit() {
+	#ifndef _WIN32
+		if (isAsync) {
+			SQL_Reactor::submit(this);
+			return;
 		}
 	#endif
-	return 0;
+	SQL_Executor::submit(this);
 }
 
-SQL_Connection::SQL_Connection(int id, AMX *amx) : pending(32) {
-	this->id = id;
-	this->amx = amx;
-	this->thread = NULL;
+void SQL_Connection::execute(SQL_Statement *stmt) {
+	if (begin(stmt)) {
+		if (stmt->flags & STATEMENT_FLAGS_TRANSACTION) {
+			executeTransaction(stmt);
+		} else {
+			executeStatement(stmt);
+		}
+	}
+	end(stmt);
 }
 
-SQL_Connection::~SQL_Connection() {
-	stopWorker();
+bool SQL_Connection::begin(SQL_Statement *stmt) {
+	buildInsert(stmt);
+	stmt->conn = this;
+	executingMutex.lock();
+	executing = stmt;
+	stmt->status = STATEMENT_STATUS_EXECUTING;
+	executingMutex.unlock();
+	return stmt->cancelError == 0;
 }
 
-void SQL_Connection::startWorker() {
-	if (thread == NULL) {
-		isActive = true;
-		#ifdef _WIN32
-			DWORD threadId = 0;
-			thread = CreateThread(NULL, NULL, (LPTHREAD_START_ROUTINE) SQL_Worker, (LPVOID) this, NULL, &threadId);
-		#else
-			pthread_attr_t attr;
-			pthread_attr_init(&attr);
-			pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-			pthread_create(&thread, &attr, &SQL_Worker, (void*) this);
-			pthread_attr_destroy(&attr);
-		#endif
+void SQL_Connection::end(SQL_Statement *stmt) {
+	executingMutex.lock();
+	executing = NULL;
+	executingMutex.unlock();
+	lastActivity = Clock::now();
+	finish(stmt);
+}
+
+void SQL_Connection::execute(std::vector<SQL_Statement*> &stmts) {
+	std::vector<SQL_Statement*> batch;
+	for (int i = 0, size = stmts.size(); i != size; ++i) {
+		buildInsert(stmts[i]);
+		stmts[i]->conn = this;
+		stmts[i]->status = STATEMENT_STATUS_EXECUTING;
+		if (stmts[i]->cancelError != 0) {
+			continue;
+		}
+		if (stmts[i]->flags & STATEMENT_FLAGS_TRANSACTION) {
+			// Transactions may be executed several times, so they are never
+			// sent together with other statements.
+			if (!batch.empty()) {
+				executeStatements(batch);
+				batch.clear();
+			}
+			executeTransaction(stmts[i]);
+		} else {
+			batch.push_back(stmts[i]);
+		}
+	}
+	if (!batch.empty()) {
+		executeStatements(batch);
+	}
+	lastActivity = Clock::now();
+	for (int i = 0, size = stmts.size(); i != size; ++i) {
+		finish(stmts[i]);
 	}
 }
 
-void SQL_Connection::stopWorker() {
-	if (thread != NULL) {
-		isActive = false;
-#ifdef _WIN32
-		WaitForSingleObject(thread, INFINITE);
-		CloseHandle(thread);
-#else
-		void *status;
-		pthread_join(thread, &status);
-#endif
-		thread = NULL;
+void SQL_Connection::finish(SQL_Statement *stmt) {
+	int error = stmt->cancelError;
+	// A statement that finished before it could be interrupted keeps its result.
+	if ((error != 0) && ((stmt->error != 0) || (stmt->resultSets.empty()))) {
+		stmt->error = error;
+		stmt->errorMsg = SQL_Statement::getErrorMessage(error);
+	}
+	if (stmt->flags & STATEMENT_FLAGS_CLOSES_CURSOR) {
+		isPinned = false;
+	}
+	stmt->status = STATEMENT_STATUS_EXECUTED;
+}
+
+bool SQL_Connection::deliverChunk(SQL_Statement *stmt) {
+	stmt->chunkState = CHUNK_STATE_READY;
+	SQL_Dispatcher::push(stmt->id);
+	// The next rows are read only after the script is done with this chunk,
+	// so a single chunk is kept in memory.
+	bool isDelivered = true;
+	while (stmt->chunkState != CHUNK_STATE_NONE) {
+		// A retiring executor thread gives up too, so it can exit.
+		if ((!isActive) || (stmt->cancelError != 0) || ((runner != NULL) && (!runner->isActive))) {
+			// The callback might be executing; it can only be left behind if
+			// the connection is closed by the callback itself.
+			int current = CHUNK_STATE_READY;
+			if ((stmt->chunkState.compare_exchange_strong(current, CHUNK_STATE_NONE)) || (!isActive)) {
+				isDelivered = false;
+				break;
+			}
+		}
+		stmt->chunkDone.wait(STREAM_WAIT_INTERVAL);
+	}
+	if (isDelivered) {
+		for (int i = 0, size = stmt->resultSets.size(); i != size; ++i) {
+			delete stmt->resultSets[i];
+		}
+		stmt->resultSets.clear();
+		stmt->lastResultIdx = 0;
+		++stmt->chunkIdx;
+	}
+	if ((!isDelivered) || (stmt->cancelError != 0)) {
+		stmt->error = stmt->cancelError != 0 ? (int) stmt->cancelError : STATEMENT_ERROR_CANCELLED;
+		stmt->errorMsg = SQL_Statement::getErrorMessage(stmt->error);
+		return false;
+	}
+	return true;
+}
+
+void SQL_Connection::executeStatements(std::vector<SQL_Statement*> &stmts) {
+	for (int i = 0, size = stmts.size(); i != size; ++i) {
+		executeStatement(stmts[i]);
+	}
+}
+
+void SQL_Connection::executeTransaction(SQL_Statement *stmt) {
+	for (int attempt = 1; ; ++attempt) {
+		executeStatement(stmt);
+		if (stmt->error == 0) {
+			break;
+		}
+		bool isRetryable = canRetry(stmt);
+		// The message might be overwritten by the rollback.
+		stmt->copyError();
+		rollback();
+		if ((!isRetryable) || (attempt == TRANSACTION_MAX_ATTEMPTS) || (!isActive) || (stmt->cancelError != 0)) {
+			break;
+		}
+		Logger::log(LOG_INFO, "SQL_Connection::executeTransaction: Transaction failed, retrying (conn->id = %d, stmt->id = %d, stmt->error = %d, attempt = %d)...", id, stmt->id, stmt->error, attempt);
+		for (int i = 0, size = stmt->resultSets.size(); i != size; ++i) {
+			delete stmt->resultSets[i];
+		}
+		stmt->resultSets.clear();
+		stmt->lastResultIdx = 0;
+		stmt->error = 0;
+		stmt->errorMsg = NULL;
+		SLEEP(attempt * TRANSACTION_RETRY_DELAY);
+	}
+	// The results of `BEGIN` and `COMMIT` aren't passed to the script.
+	if (!stmt->resultSets.empty()) {
+		delete stmt->resultSets.front();
+		stmt->resultSets.erase(stmt->resultSets.begin());
+	}
+	if ((stmt->error == 0) && (!stmt->resultSets.empty())) {
+		delete stmt->resultSets.back();
+		stmt->resultSets.pop_back();
+	}
+}
+
+bool SQL_Connection::cancel(SQL_Statement *stmt) {
+	bool ret = false;
+	executingMutex.lock();
+	if (executing == stmt) {
+		Logger::log(LOG_DEBUG, "SQL_Connection::cancel: Interrupting statement (conn->id = %d, stmt->id = %d)...", id, stmt->id);
+		interrupt();
+		ret = true;
+	}
+	executingMutex.unlock();
+	return ret;
+}
+
+bool SQL_Connection::fetchInt(SQL_Statement *stmt, int fieldIdx, int &dest) {
+	if (stmt->resultSets.empty()) {
+		return false;
+	}
+	SQL_Value value;
+	if (getValue(stmt, fieldIdx, value)) {
+		switch (value.type) {
+			case VALUE_TYPE_INT:
+				dest = (int) value.i;
+				break;
+			case VALUE_TYPE_FLOAT:
+				dest = (int) value.f;
+				break;
+			case VALUE_TYPE_STRING:
+				dest = atoi(value.str);
+				break;
+			default:
+				dest = 0;
+				break;
+		}
+		return true;
+	}
+	char *tmp = NULL;
+	int len;
+	bool isCopy = fetchNum(stmt, fieldIdx, tmp, len);
+	if (len == 0) {
+		return false;
+	}
+	dest = atoi(tmp);
+	if (isCopy) {
+		free(tmp);
+	}
+	return true;
+}
+
+bool SQL_Connection::fetchFloat(SQL_Statement *stmt, int fieldIdx, float &dest) {
+	if (stmt->resultSets.empty()) {
+		return false;
+	}
+	SQL_Value value;
+	if (getValue(stmt, fieldIdx, value)) {
+		switch (value.type) {
+			case VALUE_TYPE_INT:
+				dest = (float) value.i;
+				break;
+			case VALUE_TYPE_FLOAT:
+				dest = (float) value.f;
+				break;
+			case VALUE_TYPE_STRING:
+				dest = (float) atof(value.str);
+				break;
+			default:
+				dest = 0.0;
+				break;
+		}
+		return true;
+	}
+	char *tmp = NULL;
+	int len;
+	bool isCopy = fetchNum(stmt, fieldIdx, tmp, len);
+	if (len == 0) {
+		return false;
+	}
+	dest = (float) atof(tmp);
+	if (isCopy) {
+		free(tmp);
+	}
+	return true;
+}
+
+bool SQL_Connection::getValue(SQL_Statement *stmt, int fieldIdx, SQL_Value &value) {
+	if (stmt->resultSets.empty()) {
+		return false;
+	}
+	SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
+	if ((r->values.empty()) || (fieldIdx < 0) || (fieldIdx >= r->numFields)) {
+		return false;
+	}
+	value = r->values[r->lastRowIdx][fieldIdx];
+	return true;
+}
+
+bool SQL_Connection::canExecuteAsync() {
+	return false;
+}
+
+bool SQL_Connection::canUseCursors() {
+	return false;
+}
+
+char *SQL_Connection::getCopyCommand(const char *table, const char *columns) {
+	return NULL;
+}
+
+char *SQL_Connection::getInsertCommand(const char *table, const char *columns) {
+	std::string command = "INSERT INTO ";
+	command += table;
+	if ((columns != NULL) && (columns[0] != '\0')) {
+		command += " (";
+		command += columns;
+		command += ')';
+	}
+	command += " VALUES ";
+	char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+	strcpy(dest, command.c_str());
+	return dest;
+}
+
+void SQL_Connection::buildInsert(SQL_Statement *stmt) {
+	if ((!(stmt->flags & STATEMENT_FLAGS_INSERT)) || (stmt->data == NULL)) {
+		return;
+	}
+	// The rows are in the text format of `COPY`: the fields are unescaped
+	// and escaped again for the server.
+	std::string query = stmt->query;
+	query.reserve(query.length() + 2 * stmt->dataLen);
+	char *field = (char*) malloc(sizeof(char) * (stmt->dataLen + 1));
+	char *escaped = (char*) malloc(sizeof(char) * (2 * stmt->dataLen + 1));
+	int len = 0, numRows = 0;
+	bool isNull = false, isRowStart = true;
+	for (int i = 0; i != stmt->dataLen; ++i) {
+		char c = stmt->data[i];
+		if ((c == '\\') && (i + 1 != stmt->dataLen)) {
+			switch (stmt->data[++i]) {
+				case 't':
+					field[len++] = '\t';
+					break;
+				case 'n':
+					field[len++] = '\n';
+					break;
+				case 'r':
+					field[len++] = '\r';
+					break;
+				case 'N':
+					isNull = true;
+					break;
+				default:
+					field[len++] = stmt->data[i];
+					break;
+			}
+			continue;
+		}
+		if ((c != '\t') && (c != '\n')) {
+			field[len++] = c;
+			continue;
+		}
+		if (isRowStart) {
+			query += numRows++ == 0 ? "(" : ", (";
+		} else {
+			query += ", ";
+		}
+		if (isNull) {
+			query += "NULL";
+		} else {
+			field[len] = '\0';
+			escapeString(field, escaped);
+			query += '\'';
+			query += escaped;
+			query += '\'';
+		}
+		if (c == '\n') {
+			query += ')';
+		}
+		len = 0;
+		isNull = false;
+		isRowStart = c == '\n';
+	}
+	free(field);
+	free(escaped);
+	free(stmt->query);
+	stmt->query = (char*) malloc(sizeof(char) * (query.length() + 1));
+	strcpy(stmt->query, query.c_str());
+	free(stmt->data);
+	stmt->data = NULL;
+	stmt->dataLen = 0;
+}
+
+int SQL_Connection::getSocket() {
+	return -1;
+}
+
+bool SQL_Connection::sendStatement(SQL_Statement *stmt) {
+	return false;
+}
+
+int SQL_Connection::pollStatement(SQL_Statement *stmt) {
+	return ASYNC_DONE;
+}
+
+bool SQL_Connection::isSingleCommand(const char *query) {
+	const char *c = strchr(query, ';');
+	if (c == NULL) {
+		return true;
+	}
+	for (; *c != '\0'; ++c) {
+		if ((*c != ';') && (!isspace((unsigned char) *c))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int SQL_Connection::findField(SQL_Statement *stmt, const char *fieldName) {
+	if (stmt->resultSets.empty()) {
+		return -1;
+	}
+	SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
+	for (int i = 0, size = r->fieldNames.size(); i != size; ++i) {
+		if (strcmp(r->fieldNames[i].first, fieldName) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool SQL_Connection::fetchValue(SQL_ResultSet *r, int fieldIdx, char *&dest, int &len) {
+	if ((r->numRows == 0) || (fieldIdx < 0) || (fieldIdx >= r->numFields)) {
+		len = 0;
+		return true;
+	}
+	return formatValue(r->values[r->lastRowIdx][fieldIdx], dest, len);
+}
+
+bool SQL_Connection::formatValue(SQL_Value &value, char *&dest, int &len) {
+	if (value.type == VALUE_TYPE_STRING) {
+		if (dest == NULL) {
+			dest = value.str;
+			len = value.len;
+			return false; // It is not a copy; we warn the user that he SHOULD NOT free dest.
+		}
+		strncpy(dest, value.str, len);
+		return true;
+	}
+	char tmp[32];
+	switch (value.type) {
+		case VALUE_TYPE_INT:
+			snprintf(tmp, sizeof(tmp), "%lld", value.i);
+			break;
+		case VALUE_TYPE_FLOAT:
+			snprintf(tmp, sizeof(tmp), "%.15g", value.f);
+			break;
+		default:
+			strcpy(tmp, "NULL");
+			break;
+	}
+	if (dest == NULL) {
+		len = strlen(tmp) + 1;
+		dest = (char*) malloc(sizeof(char) * len);
+		memcpy(dest, tmp, len);
+	} else {
+		strncpy(dest, tmp, len);
 	}
+	return true;
 }
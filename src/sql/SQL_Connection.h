@@ -26,24 +26,25 @@
 #pragma once
 
 #include "sql.h"
+#include "SQL_Queue.h"
+
+#include "../Event.h"
+#include "../Mutex.h"
 
 #ifdef _WIN32
 	#include <Windows.h>
 	#define SLEEP(x) Sleep(x);
+	#define YIELD() SwitchToThread();
 #else
 	#include "pthread.h"
+	#include <sched.h>
 	#include <unistd.h>
 	#define SLEEP(x) usleep(x * 1000);
+	#define YIELD() sched_yield();
 	typedef unsigned long DWORD;
 	typedef unsigned int UINT;
 #endif
 
-#ifdef _WIN32
-	DWORD WINAPI SQL_Worker(LPVOID param);
-#else
-	void *SQL_Worker(void *param);
-#endif
-
 /**
  * An abstract SQL connection.
  */
@@ -67,29 +68,127 @@ class SQL_Connection {
 		int type;
 		
 		/**
-		 * `true` if SQL's worker thread is active, `false` otherwise.
+		 * `true` if the statements of this connection are executed, `false` otherwise.
+		 */
+		volatile bool isActive;
+		
+		/**
+		 * The state of this connection in the executor (`CONNECTION_STATE_*`).
 		 */
-		bool isActive;
+		boost::atomic<int> state;
 		
 		/**
 		 * The queue of pending queries, scheduled for execution.
 		 */
-		statementsQueue_t pending;
+		SQL_Queue pending;
 		
-	#ifdef _WIN32
-	
 		/**
-		 * Win32 thread.
+		 * The number of statements scheduled on this connection that were not
+		 * executed yet (including the one being executed).
 		 */
-		HANDLE thread;
-	#else
-	
+		boost::atomic<int> pendingCount;
+		
 		/**
-		 * UNIX thread.
+		 * The number of streamed statements counted by `pendingCount`. Their
+		 * chunks are delivered by the main thread, so it must not block while
+		 * they are executed.
 		 */
-		pthread_t thread;
-	#endif
-	
+		boost::atomic<int> streamedCount;
+		
+		/**
+		 * The moment this connection last executed a statement or was checked
+		 * (microseconds).
+		 */
+		volatile unsigned long long lastActivity;
+		
+		/**
+		 * Statistics of the prepared statements cache.
+		 */
+		volatile int preparedHits, preparedMisses, preparedEvictions;
+		
+		/**
+		 * The physical connections sharing this handle. The first member is
+		 * always the connection itself; the others are owned by it.
+		 */
+		std::vector<SQL_Connection*> pool;
+		
+		/**
+		 * The maximum number of statements waiting in the queues of the pool
+		 * (0 = no limit).
+		 */
+		int queueLimit;
+		
+		/**
+		 * What happens to a statement scheduled while the queues are full
+		 * (`QUEUE_POLICY_*`).
+		 */
+		int queuePolicy;
+		
+		/**
+		 * The maximum number of queued statements sent to the server at once
+		 * (1 = no batching).
+		 */
+		volatile int batchSize;
+		
+		/**
+		 * How long the worker waits for more statements to fill a batch
+		 * (milliseconds).
+		 */
+		volatile int batchDelay;
+		
+		/**
+		 * Whether the statements are executed by the reactor (asynchronously)
+		 * instead of the executor.
+		 */
+		volatile bool isAsync;
+		
+		/**
+		 * The number of rows of each chunk of a streamed result.
+		 */
+		volatile int streamChunk;
+		
+		/**
+		 * The maximum length of a query built by the plugin (limited by
+		 * `max_allowed_packet` on MySQL).
+		 */
+		int maxQueryLength;
+		
+		/**
+		 * Whether this member of the pool is held by a cursor (only the
+		 * statements of the cursor are scheduled on it). It is released by
+		 * the statement that closes the cursor, once it is executed.
+		 */
+		volatile bool isPinned;
+		
+		/**
+		 * The executor thread running this connection (NULL otherwise).
+		 */
+		SQL_ExecutorThread *runner;
+		
+		/**
+		 * A statement the reactor can't multiplex (NULL otherwise). It is
+		 * executed by the executor, which then gives the connection back to
+		 * the reactor.
+		 */
+		SQL_Statement *handoff;
+		
+		/**
+		 * The doorbell of the executor thread waiting for more statements to
+		 * fill a batch of this connection (NULL otherwise).
+		 */
+		boost::atomic<Event*> filling;
+		
+		/**
+		 * The statement being executed on this connection (if any).
+		 */
+		SQL_Statement *executing;
+		
+		/**
+		 * Guards `executing`: a statement is only interrupted while it is
+		 * still being executed.
+		 */
+		Mutex executingMutex;
+		
 		/**
 		 * Constructor.
 		 * @param id
@@ -102,15 +201,144 @@ class SQL_Connection {
 		virtual ~SQL_Connection();
 		
 		/**
-		 * Starts the worker thread of this SQL connection.
+		 * Allows the executor to run the statements of this connection.
 		 */
 		void startWorker();
 		
 		/**
-		 * Stops the worker thread of this SQL connection.
+		 * Stops the execution of statements and waits until the executor
+		 * releases this connection.
 		 */
 		void stopWorker();
 		
+		/**
+		 * Schedules a statement for execution on the least loaded member of
+		 * the pool. If the queues are full, the queue policy decides whether
+		 * it is rejected.
+		 * @param stmt
+		 * @param member The member the statement has to be executed on (the
+		 * statements of a cursor); it is not subject to the queue limit.
+		 */
+		void schedule(SQL_Statement *stmt, SQL_Connection *member = NULL);
+		
+		/**
+		 * Makes room for a statement in the full queues of the pool, based
+		 * on the queue policy.
+		 * @param stmt
+		 * @return `true` if the statement can be queued, `false` if it has to
+		 *         be rejected.
+		 */
+		bool makeRoom(SQL_Statement *stmt);
+		
+		/**
+		 * Pushes a statement in the queue of this member and wakes it up.
+		 * @param stmt
+		 */
+		void enqueue(SQL_Statement *stmt);
+		
+		/**
+		 * Moves the statements queued behind a busy member of the pool to
+		 * its idle members (those held by cursors are left alone).
+		 * @return The number of statements moved.
+		 */
+		int rebalance();
+		
+		/**
+		 * Checks if a member of the pool has streamed statements pending.
+		 * @return
+		 */
+		bool hasStreamed();
+		
+		/**
+		 * Gets the number of statements waiting in the queues of the pool.
+		 * @return
+		 */
+		int getQueueDepth();
+		
+		/**
+		 * Gets the moment the oldest statement waiting in the queues of the
+		 * pool was queued.
+		 * @return Microseconds or 0 if the queues are empty.
+		 */
+		unsigned long long getOldestQueued();
+		
+		/**
+		 * Marks this connection as having pending work.
+		 * @return `true` if the connection has to be submitted to the executor.
+		 */
+		bool wake();
+		
+		/**
+		 * Checks out this connection for a statement executed by the main
+		 * thread, waiting for the executor (or the keep-alive check) to
+		 * release it.
+		 * @return `true` if the connection was checked out, `false` if it has
+		 *         streamed statements pending (they wait for the main thread).
+		 */
+		bool acquire();
+		
+		/**
+		 * Releases this connection after the executor ran it.
+		 * @return `true` if the connection has to be submitted again.
+		 */
+		bool release();
+		
+		/**
+		 * Hands this connection to the executor or to the reactor, which
+		 * execute its queued statements.
+		 */
+		void submit();
+		
+		/**
+		 * Executes a statement, unless it was cancelled meanwhile.
+		 * @param stmt
+		 */
+		void execute(SQL_Statement *stmt);
+		
+		/**
+		 * Marks a statement as being executed.
+		 * @param stmt
+		 * @return `false` if the statement was cancelled meanwhile.
+		 */
+		bool begin(SQL_Statement *stmt);
+		
+		/**
+		 * Marks a statement as executed (`begin` must be called first).
+		 * @param stmt
+		 */
+		void end(SQL_Statement *stmt);
+		
+		/**
+		 * Executes several statements at once (those cancelled meanwhile are
+		 * skipped). Statements of a batch can't be interrupted once sent.
+		 * @param stmts
+		 */
+		void execute(std::vector<SQL_Statement*> &stmts);
+		
+		/**
+		 * Marks a statement as executed, reporting the cancellation (if it
+		 * was cancelled before it completed).
+		 * @param stmt
+		 */
+		void finish(SQL_Statement *stmt);
+		
+		/**
+		 * Passes the chunk of a streamed result held by a statement to the
+		 * main thread and waits until its callback was executed; the chunk
+		 * is freed afterwards.
+		 * @param stmt
+		 * @return `false` if the rest of the result has to be discarded (the
+		 * statement was cancelled or the connection is closing).
+		 */
+		bool deliverChunk(SQL_Statement *stmt);
+		
+		/**
+		 * Interrupts a statement if it is being executed on this connection.
+		 * @param stmt
+		 * @return `true` if the statement was interrupted.
+		 */
+		bool cancel(SQL_Statement *stmt);
+		
 		/**
 		 * Establishes a new connection to a SQL server.
 		 * @param host
@@ -176,6 +404,111 @@ class SQL_Connection {
 		 */
 		virtual void executeStatement(SQL_Statement *stmt) = 0;
 		
+		/**
+		 * Executes several SQL statements, in order. Backends that can send
+		 * them in fewer round trips override it.
+		 * @param stmts
+		 */
+		virtual void executeStatements(std::vector<SQL_Statement*> &stmts);
+		
+		/**
+		 * Executes a transaction (`BEGIN; ...; COMMIT`), rolling it back if
+		 * it fails and executing it again after a deadlock or serialization
+		 * failure. Only the results of the queries in between are kept.
+		 * @param stmt
+		 */
+		void executeTransaction(SQL_Statement *stmt);
+		
+		/**
+		 * Rolls back the transaction left open by a failed statement.
+		 */
+		virtual void rollback() = 0;
+		
+		/**
+		 * Checks if a failed transaction may succeed if executed again
+		 * (it failed because of a deadlock or a serialization failure).
+		 * @param stmt
+		 * @return
+		 */
+		virtual bool canRetry(SQL_Statement *stmt) = 0;
+		
+		/**
+		 * Checks if this connection can execute statements asynchronously.
+		 * @return
+		 */
+		virtual bool canExecuteAsync();
+		
+		/**
+		 * Checks if this connection supports server-side cursors.
+		 * @return
+		 */
+		virtual bool canUseCursors();
+		
+		/**
+		 * Gets the command that loads the rows of a bulk load into a table.
+		 * The rows are sent afterwards, in the text format of `COPY`.
+		 * @param table
+		 * @param columns A comma separated list (empty = all columns).
+		 * @return The command (allocated with `malloc`) or `NULL` if this
+		 * connection doesn't support bulk loads.
+		 */
+		virtual char *getCopyCommand(const char *table, const char *columns);
+		
+		/**
+		 * Gets the query that writes the changed columns of a row. The values
+		 * of the columns are bound first, followed by the primary key.
+		 * @param table
+		 * @param key The primary key column.
+		 * @param columns
+		 * @param isUpsert Whether the row is inserted if it doesn't exist.
+		 * @return The query (allocated with `malloc`).
+		 */
+		virtual char *getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert) = 0;
+		
+		/**
+		 * Gets the beginning of the query that inserts the rows of an insert
+		 * batch (`INSERT INTO ... VALUES `).
+		 * @param table
+		 * @param columns A comma separated list (empty = all columns).
+		 * @return The command (allocated with `malloc`).
+		 */
+		char *getInsertCommand(const char *table, const char *columns);
+		
+		/**
+		 * Gets the socket of the connection (used by the reactor).
+		 * @return
+		 */
+		virtual int getSocket();
+		
+		/**
+		 * Sends a statement without waiting for its result.
+		 * @param stmt
+		 * @return `false` if the statement failed right away (and its error
+		 *         was stored).
+		 */
+		virtual bool sendStatement(SQL_Statement *stmt);
+		
+		/**
+		 * Processes the data received for a statement sent by `sendStatement`.
+		 * @param stmt
+		 * @return `ASYNC_DONE` if the result was stored, `ASYNC_READING` or
+		 *         `ASYNC_WRITING` if the connection waits for the socket.
+		 */
+		virtual int pollStatement(SQL_Statement *stmt);
+		
+		/**
+		 * Asks the server to abort the statement being executed. Called from
+		 * another thread while `executeStatement` is blocked.
+		 */
+		virtual void interrupt() = 0;
+		
+		/**
+		 * Checks an idle connection with a round trip to the server and
+		 * reestablishes it if it was lost.
+		 * @return `true` if the connection is alive.
+		 */
+		virtual bool keepAlive() = 0;
+		
 		/**
 		 * Seeks a result set.
 		 * @param stmt
@@ -221,4 +554,78 @@ class SQL_Connection {
 		 * @return
 		 */
 		virtual bool fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len) = 0;
+		
+		/**
+		 * Fetches a field as an integer. Typed result sets are read directly,
+		 * the others are converted from text.
+		 * @param stmt
+		 * @param fieldIdx
+		 * @param dest
+		 * @return `false` if the field can't be found or the result is empty.
+		 */
+		virtual bool fetchInt(SQL_Statement *stmt, int fieldIdx, int &dest);
+		
+		/**
+		 * Fetches a field as a floating point number.
+		 * @param stmt
+		 * @param fieldIdx
+		 * @param dest
+		 * @return `false` if the field can't be found or the result is empty.
+		 */
+		virtual bool fetchFloat(SQL_Statement *stmt, int fieldIdx, float &dest);
+		
+		/**
+		 * Gets a field of a typed result set.
+		 * @param stmt
+		 * @param fieldIdx
+		 * @param value The value (its string, if any, is owned by the result
+		 *        set).
+		 * @return `false` if the result set is not typed or the field can't
+		 * be found.
+		 */
+		virtual bool getValue(SQL_Statement *stmt, int fieldIdx, SQL_Value &value);
+		
+		/**
+		 * Checks if a query has only one command (only those can be batched).
+		 * Semicolons inside literals are not recognized, so such queries are
+		 * never batched.
+		 * @param query
+		 * @return
+		 */
+		static bool isSingleCommand(const char *query);
+		
+		/**
+		 * Gets the index of a field by it's name.
+		 * @param stmt
+		 * @param fieldName
+		 * @return The index or -1 if the field can't be found.
+		 */
+		int findField(SQL_Statement *stmt, const char *fieldName);
+		
+		/**
+		 * Fetches a field of a typed result set as text (same semantics as
+		 * `fetchNum`).
+		 * @param r
+		 * @param fieldIdx
+		 * @param dest
+		 * @param len
+		 * @return
+		 */
+		bool fetchValue(SQL_ResultSet *r, int fieldIdx, char *&dest, int &len);
+		
+		/**
+		 * Builds the query of an insert batch from its rows, escaping them
+		 * on the connection (the rows are freed afterwards).
+		 * @param stmt
+		 */
+		void buildInsert(SQL_Statement *stmt);
+		
+		/**
+		 * Converts a typed value to text (same semantics as `fetchNum`).
+		 * @param value
+		 * @param dest
+		 * @param len
+		 * @return
+		 */
+		static bool formatValue(SQL_Value &value, char *&dest, int &len);
 };
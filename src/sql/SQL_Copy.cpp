@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "../Clock.h"
+#include "../Logger.h"
+
+#include "SQL_Connection.h"
+#include "SQL_Pools.h"
+#include "SQL_Statement.h"
+
+#include "SQL_Copy.h"
+
+SQL_Copy::SQL_Copy(int id, AMX *amx, int connectionId, char *command, const char *callback) {
+	this->id = id;
+	this->amx = amx;
+	this->connectionId = connectionId;
+	this->command = command;
+	flags = STATEMENT_FLAGS_COPY;
+	int len = (callback == NULL ? 0 : strlen(callback)) + 1;
+	this->callback = (char*) malloc(sizeof(char) * len);
+	memcpy(this->callback, callback == NULL ? "" : callback, len);
+	data = NULL;
+	this->len = size = 0;
+	numRows = numFields = 0;
+	queryLen = strlen(command);
+	rowStart = rowQueryLen = 0;
+	firstRowAt = 0;
+	maxRows = 0;
+	maxSize = COPY_DEFAULT_SIZE;
+	maxLength = 0;
+	maxAge = COPY_DEFAULT_AGE;
+}
+
+SQL_Copy::~SQL_Copy() {
+	free(command);
+	free(callback);
+	free(data);
+}
+
+void SQL_Copy::addField(const char *value) {
+	if (numFields == 0) {
+		if (numRows == 0) {
+			firstRowAt = Clock::now();
+		}
+		rowStart = len;
+		rowQueryLen = queryLen;
+	}
+	if (numFields++ != 0) {
+		append("\t", 1);
+	}
+	if (value == NULL) {
+		append("\\N", 2);
+		queryLen += 6; // ", NULL"
+		return;
+	}
+	queryLen += 2 * strlen(value) + 4; // ", '...'"
+	// Only the delimiters and the escape character itself are special in
+	// the text format.
+	for (const char *start = value; ; ++value) {
+		const char *escaped = NULL;
+		switch (*value) {
+			case '\\':
+				escaped = "\\\\";
+				break;
+			case '\t':
+				escaped = "\\t";
+				break;
+			case '\n':
+				escaped = "\\n";
+				break;
+			case '\r':
+				escaped = "\\r";
+				break;
+			case '\0':
+				append(start, value - start);
+				return;
+			default:
+				continue;
+		}
+		append(start, value - start);
+		append(escaped, 2);
+		start = value + 1;
+	}
+}
+
+void SQL_Copy::endRow() {
+	append("\n", 1);
+	queryLen += 4; // ", ()"
+	numFields = 0;
+	++numRows;
+	if ((maxLength != 0) && (queryLen > maxLength) && (numRows != 1)) {
+		// The previous rows are sent without this one.
+		int n = len - rowStart, rowLen = queryLen - rowQueryLen;
+		char *row = (char*) malloc(sizeof(char) * n);
+		memcpy(row, data + rowStart, n);
+		len = rowStart;
+		queryLen = rowQueryLen;
+		--numRows;
+		flush();
+		append(row, n);
+		free(row);
+		queryLen += rowLen;
+		if (numRows++ == 0) {
+			firstRowAt = Clock::now();
+		}
+	}
+}
+
+bool SQL_Copy::isFull() {
+	return ((maxRows != 0) && (numRows >= maxRows)) || ((maxSize != 0) && (len >= maxSize));
+}
+
+bool SQL_Copy::isDue() {
+	return (numRows != 0) && ((isFull()) || (Clock::elapsed(firstRowAt) >= maxAge));
+}
+
+int SQL_Copy::flush() {
+	if ((numRows == 0) || (!SQL_Pools::isValidConnection(connectionId))) {
+		return 0;
+	}
+	SQL_Statement *stmt = SQL_Pools::newStatement(amx, connectionId);
+	if (stmt == NULL) {
+		return 0;
+	}
+	Logger::log(LOG_DEBUG, "SQL_Copy::flush: Sending %d rows (copy->id = %d, stmt->id = %d, len = %d)...", numRows, id, stmt->id, len);
+	int commandLen = strlen(command) + 1;
+	stmt->query = (char*) malloc(sizeof(char) * commandLen);
+	memcpy(stmt->query, command, commandLen);
+	int callbackLen = strlen(callback) + 1;
+	stmt->callback = (char*) malloc(sizeof(char) * callbackLen);
+	memcpy(stmt->callback, callback, callbackLen);
+	stmt->format = (char*) malloc(sizeof(char) * 2);
+	strcpy(stmt->format, "r");
+	stmt->flags = STATEMENT_FLAGS_THREADED | flags;
+	// The buffer is handed over to the statement.
+	stmt->data = data;
+	stmt->dataLen = len;
+	data = NULL;
+	len = size = 0;
+	numRows = 0;
+	queryLen = commandLen - 1;
+	SQL_Pools::statements[stmt->id] = stmt;
+	SQL_Pools::connections[connectionId]->schedule(stmt);
+	return stmt->id;
+}
+
+void SQL_Copy::append(const char *src, int n) {
+	if (len + n > size) {
+		size = size == 0 ? 4096 : size;
+		while (len + n > size) {
+			size *= 2;
+		}
+		data = (char*) realloc(data, sizeof(char) * size);
+	}
+	memcpy(data + len, src, n);
+	len += n;
+}
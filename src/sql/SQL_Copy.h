@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "sql.h"
+
+/**
+ * A bulk load into a table. Rows are buffered in the text format of `COPY`
+ * (also read by MySQL's `LOAD DATA`) and sent to the server in large batches,
+ * either as they are or turned into a multi-row `INSERT` by the worker.
+ */
+class SQL_Copy {
+
+	public:
+
+		/**
+		 * The unique ID of this copy.
+		 */
+		int id;
+
+		/**
+		 * The AMX machine owning this copy.
+		 */
+		AMX *amx;
+
+		/**
+		 * The ID of the SQL connection owning this copy.
+		 */
+		int connectionId;
+
+		/**
+		 * The command that loads the rows on the server.
+		 */
+		char *command;
+
+		/**
+		 * The flags of the statements sending the rows
+		 * (`STATEMENT_FLAGS_COPY` or `STATEMENT_FLAGS_INSERT`).
+		 */
+		int flags;
+
+		/**
+		 * The PAWN callback executed after each batch.
+		 */
+		char *callback;
+
+		/**
+		 * The buffered rows.
+		 */
+		char *data;
+
+		/**
+		 * The length and the capacity of `data`.
+		 */
+		int len, size;
+
+		/**
+		 * The number of buffered rows.
+		 */
+		int numRows;
+
+		/**
+		 * The number of fields of the current row.
+		 */
+		int numFields;
+
+		/**
+		 * An upper bound of the length of the query built from the buffered
+		 * rows (each character might be escaped).
+		 */
+		int queryLen;
+
+		/**
+		 * Where the current row starts in `data` and `queryLen` before it.
+		 */
+		int rowStart, rowQueryLen;
+
+		/**
+		 * The moment the oldest buffered row was added.
+		 */
+		unsigned long long firstRowAt;
+
+		/**
+		 * The number of rows that triggers a flush (0 = no limit).
+		 */
+		int maxRows;
+
+		/**
+		 * The size of the buffer that triggers a flush (bytes, 0 = no limit).
+		 */
+		int maxSize;
+
+		/**
+		 * The maximum length of the query built from the rows (0 = no limit).
+		 * The row that would exceed it is sent in the next batch.
+		 */
+		int maxLength;
+
+		/**
+		 * The age of the oldest row that triggers a flush (milliseconds).
+		 */
+		int maxAge;
+
+		/**
+		 * Constructor.
+		 * @param id
+		 * @param amx
+		 * @param connectionId
+		 * @param command The command (see `SQL_Connection::getCopyCommand`),
+		 *        owned by this copy.
+		 * @param callback
+		 */
+		SQL_Copy(int id, AMX *amx, int connectionId, char *command, const char *callback);
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Copy();
+
+		/**
+		 * Adds a field to the current row.
+		 * @param value The value (`NULL` = SQL `NULL`).
+		 */
+		void addField(const char *value);
+
+		/**
+		 * Ends the current row (flushing the previous ones if the query would
+		 * be too long).
+		 */
+		void endRow();
+
+		/**
+		 * Checks if the buffer has enough rows or bytes to be flushed.
+		 * @return
+		 */
+		bool isFull();
+
+		/**
+		 * Checks if the buffer is full or old enough to be flushed.
+		 * @return
+		 */
+		bool isDue();
+
+		/**
+		 * Sends the buffered rows in a threaded statement.
+		 * @return The ID of the statement (0 if there was nothing to send).
+		 */
+		int flush();
+
+	private:
+
+		/**
+		 * Appends bytes to the buffer.
+		 * @param src
+		 * @param n
+		 */
+		void append(const char *src, int n);
+};
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "SQL_Cursor.h"
+
+SQL_Cursor::SQL_Cursor(int id, AMX *amx, int connectionId, SQL_Connection *member) {
+	this->id = id;
+	this->amx = amx;
+	this->connectionId = connectionId;
+	this->member = member;
+	snprintf(name, sizeof(name), CURSOR_NAME, id);
+	command = NULL;
+}
+
+SQL_Cursor::~SQL_Cursor() {
+	free(command);
+}
+
+void SQL_Cursor::declare(const char *query) {
+	// Scrolling backwards is not needed, so the server doesn't have to keep
+	// the rows that were already fetched.
+	setCommand("BEGIN; DECLARE %s NO SCROLL CURSOR FOR %s", name, query);
+}
+
+void SQL_Cursor::fetch(int rows) {
+	setCommand("FETCH FORWARD %d FROM %s", rows, name);
+}
+
+void SQL_Cursor::close() {
+	// It also ends transactions aborted by a failed statement.
+	setCommand("COMMIT");
+}
+
+void SQL_Cursor::setCommand(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(NULL, 0, format, args) + 1;
+	va_end(args);
+	free(command);
+	command = (char*) malloc(sizeof(char) * len);
+	va_start(args, format);
+	vsnprintf(command, len, format, args);
+	va_end(args);
+}
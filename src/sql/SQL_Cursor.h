@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "sql.h"
+
+/**
+ * A server-side cursor. It is declared in a transaction held by a member of
+ * the pool, so its rows can be fetched a few at a time; no other statement
+ * is scheduled on that member until the cursor is closed.
+ */
+class SQL_Cursor {
+
+	public:
+
+		/**
+		 * The unique ID of this cursor.
+		 */
+		int id;
+
+		/**
+		 * The AMX machine owning this cursor.
+		 */
+		AMX *amx;
+
+		/**
+		 * The ID of the SQL connection owning this cursor.
+		 */
+		int connectionId;
+
+		/**
+		 * The member of the pool holding the transaction of this cursor.
+		 */
+		SQL_Connection *member;
+
+		/**
+		 * The name of the cursor on the server.
+		 */
+		char name[32];
+
+		/**
+		 * The command executed by the next statement of this cursor.
+		 */
+		char *command;
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Cursor(int id, AMX *amx, int connectionId, SQL_Connection *member);
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Cursor();
+
+		/**
+		 * Prepares the command that opens the transaction and declares the
+		 * cursor.
+		 * @param query The query whose rows are fetched.
+		 */
+		void declare(const char *query);
+
+		/**
+		 * Prepares the command that fetches the next rows.
+		 * @param rows
+		 */
+		void fetch(int rows);
+
+		/**
+		 * Prepares the command that ends the transaction (closing the cursor).
+		 */
+		void close();
+
+	private:
+
+		/**
+		 * Replaces the command.
+		 * @param format
+		 */
+		void setCommand(const char *format, ...);
+};
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../Clock.h"
+#include "../Logger.h"
+
+#include "SQL_Pools.h"
+#include "SQL_Statement.h"
+
+#include "SQL_Dispatcher.h"
+
+int SQL_Dispatcher::budget = 0;
+
+int SQL_Dispatcher::lastDispatched = 0;
+
+int SQL_Dispatcher::lastTime = 0;
+
+int SQL_Dispatcher::backlog = 0;
+
+statementIdsQueue_t SQL_Dispatcher::completions(128);
+
+boost::atomic<int> SQL_Dispatcher::count(0);
+
+void SQL_Dispatcher::push(int id) {
+	completions.push(id);
+	++count;
+}
+
+void SQL_Dispatcher::tick() {
+	unsigned long long start = Clock::now();
+	int dispatched = 0, id;
+	while (completions.pop(id)) {
+		--count;
+		++dispatched;
+		// The statement might have been freed in the meantime.
+		if (SQL_Pools::isValidStatement(id)) {
+			SQL_Statement *stmt = SQL_Pools::statements[id];
+			int ready = CHUNK_STATE_READY;
+			if (stmt->chunkState.compare_exchange_strong(ready, CHUNK_STATE_DELIVERING)) {
+				Logger::log(LOG_DEBUG, "SQL_Dispatcher::tick: Executing query callback for a chunk (stmt->id = %d, stmt->chunkIdx = %d, stmt->callback = %s)...", stmt->id, stmt->chunkIdx, stmt->callback);
+				// The statement is still being executed; it only looks executed
+				// to the script while the callback reads the chunk.
+				stmt->status = STATEMENT_STATUS_EXECUTED;
+				stmt->executeCallback();
+				if (SQL_Pools::isValidStatement(id)) {
+					int processed = STATEMENT_STATUS_PROCESSED;
+					stmt->status.compare_exchange_strong(processed, STATEMENT_STATUS_EXECUTING);
+					stmt->chunkState = CHUNK_STATE_NONE;
+					stmt->chunkDone.set();
+				}
+			} else if ((stmt->flags & STATEMENT_FLAGS_THREADED) && (stmt->status == STATEMENT_STATUS_EXECUTED)) {
+				Logger::log(LOG_DEBUG, "SQL_Dispatcher::tick: Executing query callback (stmt->id = %d, stmt->error = %d, stmt->callback = %s)...", stmt->id, stmt->error, stmt->callback);
+				stmt->executeCallback();
+			}
+			if ((SQL_Pools::isValidStatement(id)) && (stmt->status == STATEMENT_STATUS_PROCESSED)) {
+				Logger::log(LOG_DEBUG, "SQL_Dispatcher::tick: Erasing query (stmt->id = %d)...", stmt->id);
+				SQL_Pools::statements.erase(id);
+				delete stmt;
+			}
+		}
+		if ((budget != 0) && (Clock::now() - start >= (unsigned long long) budget)) {
+			break;
+		}
+	}
+	lastDispatched = dispatched;
+	lastTime = (int) (Clock::now() - start);
+	backlog = count;
+	if ((backlog != 0) && (budget != 0)) {
+		Logger::log(LOG_DEBUG, "SQL_Dispatcher::tick: Budget exceeded (dispatched = %d, time = %d us), %d statements carried over.", lastDispatched, lastTime, backlog);
+	}
+}
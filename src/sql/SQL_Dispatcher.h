@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <boost/lockfree/queue.hpp>
+
+#include "sql.h"
+
+typedef boost::lockfree::queue<int> statementIdsQueue_t;
+
+/**
+ * Dispatches the callbacks of executed statements on the main thread.
+ */
+class SQL_Dispatcher {
+
+	public:
+
+		/**
+		 * The maximum time spent dispatching callbacks in a tick (microseconds,
+		 * 0 = unlimited). The statements left are dispatched in the next ticks.
+		 */
+		static int budget;
+
+		/**
+		 * The number of statements processed in the last tick.
+		 */
+		static int lastDispatched;
+
+		/**
+		 * The time spent processing statements in the last tick (microseconds).
+		 */
+		static int lastTime;
+
+		/**
+		 * The number of statements carried over to the next tick.
+		 */
+		static int backlog;
+
+		/**
+		 * Queues an executed statement to be processed by the main thread.
+		 * @param id
+		 */
+		static void push(int id);
+
+		/**
+		 * Processes the executed statements (called every server tick).
+		 */
+		static void tick();
+
+	/**
+	 * Static class.
+	 */
+	private:
+
+		/**
+		 * The IDs of the statements that were executed and have to be
+		 * processed by the main thread.
+		 */
+		static statementIdsQueue_t completions;
+
+		/**
+		 * The number of IDs in `completions`.
+		 */
+		static boost::atomic<int> count;
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Dispatcher();
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Dispatcher();
+};
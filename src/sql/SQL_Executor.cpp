@@ -0,0 +1,381 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../Clock.h"
+#include "../Logger.h"
+
+#include "SQL_Connection.h"
+#include "SQL_Dispatcher.h"
+#include "SQL_Statement.h"
+
+#if defined PLUGIN_SUPPORTS_MYSQL
+	#include "mysql/mysql.h"
+#endif
+
+#include "SQL_Executor.h"
+
+std::vector<SQL_ExecutorThread*> SQL_Executor::threads;
+
+Event SQL_Executor::completed;
+
+std::deque<SQL_Connection*> SQL_Executor::orphans;
+
+std::vector<SQL_ExecutorThread*> SQL_Executor::retired;
+
+Mutex SQL_Executor::mutex;
+
+boost::atomic<int> SQL_Executor::queued(0);
+
+boost::atomic<int> SQL_Executor::nextThread(0);
+
+void SQL_Executor::start(int count) {
+	mutex.lock();
+	if (!threads.empty()) {
+		mutex.unlock();
+		return;
+	}
+	if (count < 1) {
+		count = 1;
+	}
+	Logger::log(LOG_INFO, "SQL_Executor::start: Starting %d threads...", count);
+	for (int i = 0; i != count; ++i) {
+		SQL_ExecutorThread *thread = new SQL_ExecutorThread();
+		thread->index = i;
+		thread->isActive = true;
+		thread->hasExited = false;
+		thread->isParked = false;
+		threads.push_back(thread);
+	}
+	while (!orphans.empty()) {
+		++queued;
+		push(threads[nextThread++ % count], orphans.front());
+		orphans.pop_front();
+	}
+	for (int i = 0; i != count; ++i) {
+		spawn(threads[i]);
+	}
+	mutex.unlock();
+}
+
+void SQL_Executor::spawn(SQL_ExecutorThread *thread) {
+	#ifdef _WIN32
+		DWORD threadId = 0;
+		thread->thread = CreateThread(NULL, NULL, (LPTHREAD_START_ROUTINE) worker, (LPVOID) thread, NULL, &threadId);
+	#else
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&thread->thread, &attr, &worker, (void*) thread);
+		pthread_attr_destroy(&attr);
+	#endif
+}
+
+void SQL_Executor::reap(bool wait) {
+	for (int i = 0; i < (int) retired.size(); ) {
+		SQL_ExecutorThread *thread = retired[i];
+		if ((!wait) && (!thread->hasExited)) {
+			++i;
+			continue;
+		}
+		#ifdef _WIN32
+			WaitForSingleObject(thread->thread, INFINITE);
+			CloseHandle(thread->thread);
+		#else
+			void *status;
+			pthread_join(thread->thread, &status);
+		#endif
+		delete thread;
+		retired[i] = retired.back();
+		retired.pop_back();
+	}
+}
+
+void SQL_Executor::stop() {
+	mutex.lock();
+	for (int i = 0, size = threads.size(); i != size; ++i) {
+		threads[i]->isActive = false;
+		threads[i]->doorbell.set();
+	}
+	for (int i = 0, size = threads.size(); i != size; ++i) {
+		SQL_ExecutorThread *thread = threads[i];
+		#ifdef _WIN32
+			WaitForSingleObject(thread->thread, INFINITE);
+			CloseHandle(thread->thread);
+		#else
+			void *status;
+			pthread_join(thread->thread, &status);
+		#endif
+	}
+	// The threads are freed only after all of them stopped because they steal
+	// from each other until then.
+	for (int i = 0, size = threads.size(); i != size; ++i) {
+		SQL_ExecutorThread *thread = threads[i];
+		orphans.insert(orphans.end(), thread->tasks.begin(), thread->tasks.end());
+		queued -= thread->tasks.size();
+		delete thread;
+	}
+	threads.clear();
+	reap(true);
+	mutex.unlock();
+}
+
+void SQL_Executor::resize(int count) {
+	if (count < 1) {
+		count = 1;
+	}
+	mutex.lock();
+	reap(false);
+	int size = threads.size();
+	if ((size == 0) || (count == size)) {
+		mutex.unlock();
+		if (size == 0) {
+			start(count);
+		}
+		return;
+	}
+	Logger::log(LOG_INFO, "SQL_Executor::resize: Changing the number of threads from %d to %d...", size, count);
+	for (int i = size; i < count; ++i) {
+		SQL_ExecutorThread *thread = new SQL_ExecutorThread();
+		thread->index = i;
+		thread->isActive = true;
+		thread->hasExited = false;
+		thread->isParked = false;
+		threads.push_back(thread);
+		spawn(thread);
+	}
+	// The surplus threads are never waited for: one of them might be running
+	// a streamed statement, which needs the main thread to go on.
+	for (int i = size - 1; i >= count; --i) {
+		SQL_ExecutorThread *thread = threads[i];
+		threads.pop_back();
+		thread->isActive = false;
+		thread->mutex.lock();
+		std::deque<SQL_Connection*> tasks;
+		tasks.swap(thread->tasks);
+		thread->mutex.unlock();
+		thread->doorbell.set();
+		while (!tasks.empty()) {
+			push(threads[nextThread++ % count], tasks.front());
+			tasks.pop_front();
+		}
+		retired.push_back(thread);
+	}
+	mutex.unlock();
+}
+
+void SQL_Executor::submit(SQL_Connection *conn) {
+	mutex.lock();
+	if (threads.empty()) {
+		orphans.push_back(conn);
+		mutex.unlock();
+		return;
+	}
+	// The counter is incremented before looking for a parked thread; a thread
+	// that is about to park checks it after it marks itself as parked, so one
+	// of them always notices the other.
+	++queued;
+	SQL_ExecutorThread *target = NULL;
+	for (int i = 0, size = threads.size(); i != size; ++i) {
+		if (threads[i]->isParked) {
+			target = threads[i];
+			break;
+		}
+	}
+	if (target == NULL) {
+		target = threads[nextThread++ % threads.size()];
+	}
+	push(target, conn);
+	mutex.unlock();
+}
+
+void SQL_Executor::push(SQL_ExecutorThread *thread, SQL_Connection *conn) {
+	thread->mutex.lock();
+	thread->tasks.push_back(conn);
+	thread->mutex.unlock();
+	thread->doorbell.set();
+}
+
+SQL_Connection *SQL_Executor::take(SQL_ExecutorThread *thread) {
+	SQL_Connection *conn = NULL;
+	if (queued == 0) {
+		return NULL;
+	}
+	thread->mutex.lock();
+	if (!thread->tasks.empty()) {
+		conn = thread->tasks.front();
+		thread->tasks.pop_front();
+	}
+	thread->mutex.unlock();
+	if ((conn == NULL) && (thread->isActive)) {
+		// The list of threads may be changed by `resize`.
+		mutex.lock();
+		for (int i = 1, size = threads.size(); (conn == NULL) && (i < size); ++i) {
+			SQL_ExecutorThread *victim = threads[(thread->index + i) % size];
+			victim->mutex.lock();
+			if (!victim->tasks.empty()) {
+				conn = victim->tasks.back();
+				victim->tasks.pop_back();
+			}
+			victim->mutex.unlock();
+		}
+		mutex.unlock();
+	}
+	if (conn != NULL) {
+		--queued;
+	}
+	return conn;
+}
+
+void SQL_Executor::run(SQL_ExecutorThread *thread, SQL_Connection *conn) {
+	conn->state = CONNECTION_STATE_RUNNING;
+	conn->runner = thread;
+	SQL_Statement *stmt = conn->handoff;
+	if (stmt != NULL) {
+		Logger::log(LOG_DEBUG, "SQL_Executor[%d]: Executing query for the reactor (conn->id = %d, stmt->id = %d, stmt->query = %s)...", thread->index, conn->id, stmt->id, stmt->query);
+		conn->handoff = NULL;
+		int id = stmt->id;
+		bool isStreamed = (stmt->flags & STATEMENT_FLAGS_STREAMED) != 0;
+		conn->execute(stmt);
+		SQL_Dispatcher::push(id);
+		--conn->pendingCount;
+		if (isStreamed) {
+			--conn->streamedCount;
+		}
+		completed.set();
+		conn->runner = NULL;
+		// The rest of the queue is executed by the reactor again.
+		if (conn->release()) {
+			conn->submit();
+		}
+		return;
+	}
+	std::vector<SQL_Statement*> batch;
+	std::vector<int> ids;
+	int streamed = 0;
+	for (int i = 0; (i != EXECUTOR_QUOTA) && (conn->isActive) && (thread->isActive) && (conn->pending.pop(stmt)); ++i) {
+		batch.push_back(stmt);
+		unsigned long long start = Clock::now();
+		if (conn->batchDelay != 0) {
+			conn->filling = &thread->doorbell;
+		}
+		while ((i + 1 != EXECUTOR_QUOTA) && ((int) batch.size() < conn->batchSize)) {
+			int remaining;
+			if (conn->pending.pop(stmt)) {
+				batch.push_back(stmt);
+				++i;
+			} else if ((conn->isActive) && ((remaining = conn->batchDelay - Clock::elapsed(start)) > 0)) {
+				// Small batches wait a bit for more statements (`schedule`
+				// rings the doorbell).
+				thread->doorbell.wait(remaining);
+			} else {
+				break;
+			}
+		}
+		conn->filling = NULL;
+		for (int j = 0, size = batch.size(); j != size; ++j) {
+			Logger::log(LOG_DEBUG, "SQL_Executor[%d]: Executing query (conn->id = %d, stmt->id = %d, stmt->query = %s, latency = %d us)...", thread->index, conn->id, batch[j]->id, batch[j]->query, (int) (Clock::now() - batch[j]->queuedAt));
+			// Once executed, the statement may be freed by the main thread.
+			ids.push_back(batch[j]->id);
+			if (batch[j]->flags & STATEMENT_FLAGS_STREAMED) {
+				++streamed;
+			}
+		}
+		if (batch.size() == 1) {
+			conn->execute(batch[0]);
+		} else {
+			conn->execute(batch);
+		}
+		for (int j = 0, size = ids.size(); j != size; ++j) {
+			SQL_Dispatcher::push(ids[j]);
+			--conn->pendingCount;
+		}
+		conn->streamedCount -= streamed;
+		completed.set();
+		batch.clear();
+		ids.clear();
+		streamed = 0;
+	}
+	conn->runner = NULL;
+	// Once released, the connection may be destroyed by the main thread, so
+	// it must not be touched unless it has to be resubmitted.
+	if (conn->release()) {
+		if (thread->isActive) {
+			++queued;
+			push(thread, conn);
+		} else {
+			// This thread is retiring.
+			submit(conn);
+		}
+	}
+}
+
+#ifdef _WIN32
+DWORD WINAPI SQL_Executor::worker(LPVOID param) {
+#else
+void *SQL_Executor::worker(void *param) {
+#endif
+	SQL_ExecutorThread *thread = (SQL_ExecutorThread*) param;
+	#if defined PLUGIN_SUPPORTS_MYSQL
+		mysql_thread_init();
+	#endif
+	int spinLimit = WORKER_SPIN_MIN;
+	while (thread->isActive) {
+		SQL_Connection *conn = take(thread);
+		if (conn != NULL) {
+			run(thread, conn);
+			continue;
+		}
+		// Spinning a little before parking catches bursts of queries without
+		// paying for a context switch. The spin budget grows while it pays off
+		// and shrinks while the thread ends up parked anyway.
+		bool hasWork = false;
+		for (int i = 0; (i != spinLimit) && (thread->isActive); ++i) {
+			if (queued != 0) {
+				hasWork = true;
+				break;
+			}
+			YIELD();
+		}
+		if (hasWork) {
+			if (spinLimit < WORKER_SPIN_MAX) {
+				spinLimit *= 2;
+			}
+		} else {
+			if (spinLimit > WORKER_SPIN_MIN) {
+				spinLimit /= 2;
+			}
+			thread->isParked = true;
+			if ((queued == 0) && (thread->isActive)) {
+				thread->doorbell.wait();
+			}
+			thread->isParked = false;
+		}
+	}
+	#if defined PLUGIN_SUPPORTS_MYSQL
+		mysql_thread_end();
+	#endif
+	thread->hasExited = true;
+	return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include "sql.h"
+
+#include "../Event.h"
+#include "../Mutex.h"
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include "pthread.h"
+#endif
+
+/**
+ * A thread of the executor.
+ */
+struct SQL_ExecutorThread {
+
+	/**
+	 * The index of this thread.
+	 */
+	int index;
+
+	/**
+	 * `true` if this thread is active, `false` if it is stopping or retiring
+	 * (it exits after the connection it is running).
+	 */
+	volatile bool isActive;
+
+	/**
+	 * `true` once the main loop of this thread returned.
+	 */
+	boost::atomic<bool> hasExited;
+
+	/**
+	 * `true` if this thread is parked (waiting for work), `false` otherwise.
+	 */
+	boost::atomic<bool> isParked;
+
+	/**
+	 * Wakes up this thread when new work is submitted.
+	 */
+	Event doorbell;
+
+	/**
+	 * Guards `tasks`.
+	 */
+	Mutex mutex;
+
+	/**
+	 * Connections with pending work. The owner takes them from the front,
+	 * other threads steal them from the back.
+	 */
+	std::deque<SQL_Connection*> tasks;
+
+	#ifdef _WIN32
+
+		/**
+		 * Win32 thread.
+		 */
+		HANDLE thread;
+	#else
+
+		/**
+		 * UNIX thread.
+		 */
+		pthread_t thread;
+	#endif
+};
+
+/**
+ * A fixed set of threads executing the statements of all connections.
+ *
+ * The unit of work is a connection that has pending statements: only one
+ * thread can check out a connection at a time (which keeps the statements
+ * of a connection in order) and every idle thread may steal it.
+ */
+class SQL_Executor {
+
+	public:
+
+		/**
+		 * The threads of the executor.
+		 */
+		static std::vector<SQL_ExecutorThread*> threads;
+
+		/**
+		 * Signaled every time a statement is executed (used by the main thread
+		 * to wait for statements).
+		 */
+		static Event completed;
+
+		/**
+		 * Starts the executor.
+		 * @param count The number of threads.
+		 */
+		static void start(int count);
+
+		/**
+		 * Stops the executor. Connections that were not executed yet are kept
+		 * and will be redistributed when the executor is started again.
+		 */
+		static void stop();
+
+		/**
+		 * Changes the number of threads. New threads are added alongside the
+		 * old ones and the surplus ones retire after their current connection,
+		 * so the caller never waits for a query.
+		 * @param count
+		 */
+		static void resize(int count);
+
+		/**
+		 * Submits a connection that has pending work.
+		 * @param conn
+		 */
+		static void submit(SQL_Connection *conn);
+
+	/**
+	 * Static class.
+	 */
+	private:
+
+		/**
+		 * The connections left over after the executor was stopped.
+		 */
+		static std::deque<SQL_Connection*> orphans;
+
+		/**
+		 * The threads removed by `resize` that were not freed yet.
+		 */
+		static std::vector<SQL_ExecutorThread*> retired;
+
+		/**
+		 * Guards `threads`, `orphans` and `retired` (`submit` is also called
+		 * by the watchdog and the workers steal through `threads`).
+		 */
+		static Mutex mutex;
+
+		/**
+		 * The number of connections waiting in all task queues.
+		 */
+		static boost::atomic<int> queued;
+
+		/**
+		 * The thread that will receive the next submission if no thread is parked.
+		 */
+		static boost::atomic<int> nextThread;
+
+		/**
+		 * Starts the system thread of an executor thread.
+		 * @param thread
+		 */
+		static void spawn(SQL_ExecutorThread *thread);
+
+		/**
+		 * Frees the retired threads that exited.
+		 * @param wait `true` if the threads that are still running are waited for.
+		 */
+		static void reap(bool wait);
+
+		/**
+		 * Pushes a connection to the task queue of a thread. The caller must
+		 * increment `queued` beforehand.
+		 * @param thread
+		 * @param conn
+		 */
+		static void push(SQL_ExecutorThread *thread, SQL_Connection *conn);
+
+		/**
+		 * Takes a connection from the task queue of a thread or steals one
+		 * from the other threads.
+		 * @param thread
+		 * @return
+		 */
+		static SQL_Connection *take(SQL_ExecutorThread *thread);
+
+		/**
+		 * Executes the pending statements of a connection.
+		 * @param thread
+		 * @param conn
+		 */
+		static void run(SQL_ExecutorThread *thread, SQL_Connection *conn);
+
+		/**
+		 * The main loop of an executor thread.
+		 * @param param
+		 */
+		#ifdef _WIN32
+			static DWORD WINAPI worker(LPVOID param);
+		#else
+			static void *worker(void *param);
+		#endif
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Executor();
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Executor();
+};
@@ -23,8 +23,19 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+
+#include "../Clock.h"
+#include "../Logger.h"
+
 #include "SQL_Connection.h"
+#include "SQL_Copy.h"
+#include "SQL_Cursor.h"
+#include "SQL_Executor.h"
+#include "SQL_Prepared.h"
 #include "SQL_Statement.h"
+#include "SQL_Store.h"
+#include "SQL_Watchdog.h"
 
 #if defined PLUGIN_SUPPORTS_MYSQL
 	#include "mysql/MySQL_Connection.h"
@@ -36,6 +47,11 @@
 	#include "pgsql/PgSQL_Statement.h"
 #endif
 
+#if defined PLUGIN_SUPPORTS_SQLITE
+	#include "sqlite/SQLite_Connection.h"
+	#include "sqlite/SQLite_Statement.h"
+#endif
+
 #include "SQL_Pools.h"
 
 int SQL_Pools::lastConnectionId = 1;
@@ -46,6 +62,34 @@ int SQL_Pools::lastStatementId = 1;
 
 statementsMap_t SQL_Pools::statements;
 
+int SQL_Pools::lastPreparedId = 1;
+
+preparedMap_t SQL_Pools::prepared;
+
+int SQL_Pools::lastCursorId = 1;
+
+cursorsMap_t SQL_Pools::cursors;
+
+int SQL_Pools::lastCopyId = 1;
+
+copiesMap_t SQL_Pools::copies;
+
+int SQL_Pools::lastStoreId = 1;
+
+storesMap_t SQL_Pools::stores;
+
+statementsMap_t SQL_Pools::batches;
+
+int SQL_Pools::drainTimeout = DRAIN_DEFAULT_TIMEOUT;
+
+int SQL_Pools::lastFlushed = 0;
+
+int SQL_Pools::lastAbandoned = 0;
+
+std::vector<SQL_Connection*> SQL_Pools::zombies;
+
+std::vector<SQL_Statement*> SQL_Pools::orphans;
+
 bool SQL_Pools::isValidConnection(int id) {
 	return connections.find(id) != connections.end();
 }
@@ -54,16 +98,41 @@ bool SQL_Pools::isValidStatement(int id) {
 	return statements.find(id) != statements.end();
 }
 
-SQL_Connection *SQL_Pools::newConnection(AMX *amx, int type) {
+bool SQL_Pools::isValidPrepared(int id) {
+	return prepared.find(id) != prepared.end();
+}
+
+bool SQL_Pools::isValidCursor(int id) {
+	return cursors.find(id) != cursors.end();
+}
+
+bool SQL_Pools::isValidCopy(int id) {
+	return copies.find(id) != copies.end();
+}
+
+bool SQL_Pools::isValidStore(int id) {
+	return stores.find(id) != stores.end();
+}
+
+bool SQL_Pools::isValidBatch(int id) {
+	return batches.find(id) != batches.end();
+}
+
+SQL_Connection *SQL_Pools::newConnection(AMX *amx, int type, int id) {
 	switch (type) {
 		#if defined PLUGIN_SUPPORTS_MYSQL
 			case PLUGIN_SUPPORTS_MYSQL: {
-				return new MySQL_Connection(lastConnectionId++, amx);
+				return new MySQL_Connection(id == 0 ? lastConnectionId++ : id, amx);
 			}
 		#endif
 		#if defined PLUGIN_SUPPORTS_PGSQL
 			case PLUGIN_SUPPORTS_PGSQL: {
-				return new PgSQL_Connection(lastConnectionId++, amx);
+				return new PgSQL_Connection(id == 0 ? lastConnectionId++ : id, amx);
+			}
+		#endif
+		#if defined PLUGIN_SUPPORTS_SQLITE
+			case PLUGIN_SUPPORTS_SQLITE: {
+				return new SQLite_Connection(id == 0 ? lastConnectionId++ : id, amx);
 			}
 		#endif
 	}
@@ -83,6 +152,198 @@ SQL_Statement *SQL_Pools::newStatement(AMX *amx, int connectionId) {
 				return new PgSQL_Statement(lastStatementId++, amx, connectionId);
 			}
 		#endif
+		#if defined PLUGIN_SUPPORTS_SQLITE
+			case PLUGIN_SUPPORTS_SQLITE: {
+				return new SQLite_Statement(lastStatementId++, amx, connectionId);
+			}
+		#endif
 	}
 	return NULL;
 }
+
+void SQL_Pools::freeStatements(int connectionId) {
+	for (statementsMap_t::iterator it = statements.begin(), next = it, end = statements.end(); it != end; it = next) {
+		++next;
+		SQL_Statement *stmt = it->second;
+		if (stmt->connectionId == connectionId) {
+			statements.erase(it);
+			delete stmt;
+		}
+	}
+}
+
+void SQL_Pools::freePrepared(int connectionId) {
+	for (preparedMap_t::iterator it = prepared.begin(), next = it, end = prepared.end(); it != end; it = next) {
+		++next;
+		SQL_Prepared *stmt = it->second;
+		if (stmt->connectionId == connectionId) {
+			prepared.erase(it);
+			delete stmt;
+		}
+	}
+}
+
+void SQL_Pools::freeCursors(int connectionId) {
+	for (cursorsMap_t::iterator it = cursors.begin(), next = it, end = cursors.end(); it != end; it = next) {
+		++next;
+		SQL_Cursor *cursor = it->second;
+		if (cursor->connectionId == connectionId) {
+			cursors.erase(it);
+			delete cursor;
+		}
+	}
+}
+
+void SQL_Pools::flushCopies() {
+	for (copiesMap_t::iterator it = copies.begin(), end = copies.end(); it != end; ++it) {
+		if (it->second->isDue()) {
+			it->second->flush();
+		}
+	}
+}
+
+void SQL_Pools::freeCopies(int connectionId) {
+	for (copiesMap_t::iterator it = copies.begin(), next = it, end = copies.end(); it != end; it = next) {
+		++next;
+		SQL_Copy *copy = it->second;
+		if (copy->connectionId == connectionId) {
+			copy->flush();
+			copies.erase(it);
+			delete copy;
+		}
+	}
+}
+
+void SQL_Pools::flushStores() {
+	for (storesMap_t::iterator it = stores.begin(), end = stores.end(); it != end; ++it) {
+		if (it->second->isDue()) {
+			it->second->flush();
+		}
+	}
+}
+
+void SQL_Pools::freeStores(int connectionId) {
+	for (storesMap_t::iterator it = stores.begin(), next = it, end = stores.end(); it != end; it = next) {
+		++next;
+		SQL_Store *store = it->second;
+		if (store->connectionId == connectionId) {
+			store->flush();
+			stores.erase(it);
+			delete store;
+		}
+	}
+}
+
+void SQL_Pools::freeBatches(int connectionId) {
+	for (statementsMap_t::iterator it = batches.begin(), next = it, end = batches.end(); it != end; it = next) {
+		++next;
+		SQL_Statement *stmt = it->second;
+		if (stmt->connectionId == connectionId) {
+			batches.erase(it);
+			delete stmt;
+		}
+	}
+}
+
+void SQL_Pools::drainConnections(std::vector<SQL_Connection*> &conns, int timeout) {
+	std::vector<SQL_Connection*> members;
+	int moved = 0;
+	for (int i = 0, size = conns.size(); i != size; ++i) {
+		members.insert(members.end(), conns[i]->pool.begin(), conns[i]->pool.end());
+		// The members that are idle help the busy ones.
+		moved += conns[i]->rebalance();
+	}
+	int pending = 0;
+	for (int i = 0, size = members.size(); i != size; ++i) {
+		pending += members[i]->pendingCount;
+	}
+	unsigned long long start = Clock::now();
+	for (;;) {
+		bool isDone = true;
+		for (int i = 0, size = members.size(); i != size; ++i) {
+			if ((members[i]->isActive) && (members[i]->pendingCount != 0)) {
+				isDone = false;
+				break;
+			}
+		}
+		int remaining = timeout - Clock::elapsed(start);
+		if ((isDone) || (remaining <= 0)) {
+			break;
+		}
+		SQL_Executor::completed.wait(remaining);
+	}
+	// All members are stopped first, then waited for.
+	for (int i = 0, size = members.size(); i != size; ++i) {
+		members[i]->isActive = false;
+	}
+	// The statements that are still executing are interrupted. Statements are
+	// only freed by this thread, so they can be used after the lock is released.
+	int interrupted = 0;
+	for (int i = 0, size = members.size(); i != size; ++i) {
+		members[i]->executingMutex.lock();
+		SQL_Statement *stmt = members[i]->executing;
+		members[i]->executingMutex.unlock();
+		if (stmt != NULL) {
+			SQL_Watchdog::cancel(stmt, STATEMENT_ERROR_CANCELLED);
+			++interrupted;
+		}
+	}
+	unsigned long long stopped = Clock::now();
+	int abandoned = interrupted;
+	for (int i = 0, size = members.size(); i != size; ++i) {
+		while ((members[i]->state != CONNECTION_STATE_IDLE) && (Clock::elapsed(stopped) < DRAIN_INTERRUPT_TIMEOUT)) {
+			SLEEP(1);
+		}
+		abandoned += members[i]->pending.size();
+		if (members[i]->state != CONNECTION_STATE_IDLE) {
+			// The statements this member is still executing can't be freed
+			// with the others; they are freed together with the connection.
+			Logger::log(LOG_WARNING, "SQL_Pools::drainConnections: Connection is not responding (conn->id = %d).", members[i]->id);
+			for (statementsMap_t::iterator it = statements.begin(), next = it, end = statements.end(); it != end; it = next) {
+				++next;
+				SQL_Statement *stmt = it->second;
+				if ((stmt->conn == members[i]) && (stmt->status == STATEMENT_STATUS_EXECUTING)) {
+					statements.erase(it);
+					orphans.push_back(stmt);
+				}
+			}
+		}
+	}
+	lastFlushed = pending - abandoned;
+	lastAbandoned = abandoned;
+	Logger::log(abandoned == 0 ? LOG_INFO : LOG_WARNING, "SQL_Pools::drainConnections: %d connections stopped in %d ms (flushed = %d, abandoned = %d, moved = %d).", (int) members.size(), Clock::elapsed(start), lastFlushed, lastAbandoned, moved);
+}
+
+void SQL_Pools::freeConnection(SQL_Connection *conn) {
+	if (!deleteConnection(conn)) {
+		zombies.push_back(conn);
+	}
+}
+
+void SQL_Pools::reapConnections() {
+	for (int i = 0; i != (int) zombies.size(); ) {
+		if (deleteConnection(zombies[i])) {
+			zombies.erase(zombies.begin() + i);
+		} else {
+			++i;
+		}
+	}
+}
+
+bool SQL_Pools::deleteConnection(SQL_Connection *conn) {
+	for (int i = 0, size = conn->pool.size(); i != size; ++i) {
+		if (conn->pool[i]->state != CONNECTION_STATE_IDLE) {
+			return false;
+		}
+	}
+	for (int i = 0; i != (int) orphans.size(); ) {
+		if (std::find(conn->pool.begin(), conn->pool.end(), orphans[i]->conn) != conn->pool.end()) {
+			delete orphans[i];
+			orphans.erase(orphans.begin() + i);
+		} else {
+			++i;
+		}
+	}
+	delete conn;
+	return true;
+}
@@ -53,6 +53,75 @@ class SQL_Pools {
 		 * A map of active statements.
 		 */
 		static statementsMap_t statements;
+		
+		/**
+		 * The ID of the last prepared statement.
+		 */
+		static int lastPreparedId;
+		
+		/**
+		 * A map of prepared statements.
+		 */
+		static preparedMap_t prepared;
+		
+		/**
+		 * The ID of the last cursor.
+		 */
+		static int lastCursorId;
+		
+		/**
+		 * A map of open cursors.
+		 */
+		static cursorsMap_t cursors;
+		
+		/**
+		 * The ID of the last copy.
+		 */
+		static int lastCopyId;
+		
+		/**
+		 * A map of bulk loads in progress.
+		 */
+		static copiesMap_t copies;
+		
+		/**
+		 * The ID of the last store.
+		 */
+		static int lastStoreId;
+		
+		/**
+		 * A map of write-behind stores.
+		 */
+		static storesMap_t stores;
+		
+		/**
+		 * A map of transactional batches that weren't committed yet (they
+		 * share the IDs of statements).
+		 */
+		static statementsMap_t batches;
+		
+		/**
+		 * The time connections are given to execute their queued statements
+		 * before they are stopped (milliseconds).
+		 */
+		static int drainTimeout;
+		
+		/**
+		 * The number of statements executed and abandoned by the last drain.
+		 */
+		static int lastFlushed, lastAbandoned;
+		
+		/**
+		 * Connections that were still executing a statement when their drain
+		 * gave up on them. They are freed once they are idle.
+		 */
+		static std::vector<SQL_Connection*> zombies;
+		
+		/**
+		 * Statements that were still being executed by a zombie connection.
+		 * They are freed together with their connection.
+		 */
+		static std::vector<SQL_Statement*> orphans;
 	
 		/**
 		 * Checks if a connection is valid.
@@ -67,13 +136,50 @@ class SQL_Pools {
 		 * @return
 		 */
 		static bool isValidStatement(int id);
+	
+		/**
+		 * Checks if a prepared statement is valid.
+		 * @param id
+		 * @return
+		 */
+		static bool isValidPrepared(int id);
+	
+		/**
+		 * Checks if a cursor is valid.
+		 * @param id
+		 * @return
+		 */
+		static bool isValidCursor(int id);
+	
+		/**
+		 * Checks if a copy is valid.
+		 * @param id
+		 * @return
+		 */
+		static bool isValidCopy(int id);
+	
+		/**
+		 * Checks if a store is valid.
+		 * @param id
+		 * @return
+		 */
+		static bool isValidStore(int id);
+	
+		/**
+		 * Checks if a batch is valid.
+		 * @param id
+		 * @return
+		 */
+		static bool isValidBatch(int id);
 		
 		/**
 		 * Creates a new SQL connection instsance.
+		 * @param amx
 		 * @param type
+		 * @param id The ID of the handle this connection belongs to (0 = new handle).
 		 * @return
 		 */ 
-		static SQL_Connection *newConnection(AMX *amx, int type);
+		static SQL_Connection *newConnection(AMX *amx, int type, int id = 0);
 		
 		/**
 		 * Creates a new SQL statement instsance.
@@ -82,6 +188,81 @@ class SQL_Pools {
 		 * @return
 		 */ 
 		static SQL_Statement *newStatement(AMX *amx, int connectionId);
+		
+		/**
+		 * Destroys all statements of a connection.
+		 * @param connectionId
+		 */
+		static void freeStatements(int connectionId);
+		
+		/**
+		 * Destroys all prepared statements of a connection.
+		 * @param connectionId
+		 */
+		static void freePrepared(int connectionId);
+		
+		/**
+		 * Destroys all cursors of a connection.
+		 * @param connectionId
+		 */
+		static void freeCursors(int connectionId);
+		
+		/**
+		 * Flushes the copies whose rows waited long enough.
+		 */
+		static void flushCopies();
+		
+		/**
+		 * Flushes and destroys all copies of a connection.
+		 * @param connectionId
+		 */
+		static void freeCopies(int connectionId);
+		
+		/**
+		 * Flushes the stores whose interval elapsed.
+		 */
+		static void flushStores();
+		
+		/**
+		 * Flushes and destroys all stores of a connection.
+		 * @param connectionId
+		 */
+		static void freeStores(int connectionId);
+		
+		/**
+		 * Destroys all batches of a connection (without committing them).
+		 * @param connectionId
+		 */
+		static void freeBatches(int connectionId);
+		
+		/**
+		 * Stops several connections at once. They keep executing their queued
+		 * statements (in parallel) until they are done or the timeout expires.
+		 * Statements that are still executing then are interrupted.
+		 * @param conns
+		 * @param timeout Milliseconds (0 = queued statements are abandoned).
+		 */
+		static void drainConnections(std::vector<SQL_Connection*> &conns, int timeout);
+		
+		/**
+		 * Frees a drained connection. If one of its members is still executing
+		 * a statement, it is freed later (@see reapConnections).
+		 * @param conn
+		 */
+		static void freeConnection(SQL_Connection *conn);
+		
+		/**
+		 * Frees the zombie connections that became idle.
+		 */
+		static void reapConnections();
+		
+		/**
+		 * Frees a connection and its orphaned statements, unless one of its
+		 * members is still executing a statement.
+		 * @param conn
+		 * @return `true` if the connection was freed.
+		 */
+		static bool deleteConnection(SQL_Connection *conn);
 
 	/**
 	 * Static class.
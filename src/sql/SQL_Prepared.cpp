@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "SQL_Prepared.h"
+
+SQL_Prepared::SQL_Prepared(int id, AMX *amx, int connectionId) {
+	this->id = id;
+	this->amx = amx;
+	this->connectionId = connectionId;
+	query = NULL;
+}
+
+SQL_Prepared::~SQL_Prepared() {
+	free(query);
+	for (int i = 0, size = params.size(); i != size; ++i) {
+		free(params[i].str);
+	}
+}
+
+bool SQL_Prepared::bind(int paramIdx, const SQL_Value &value) {
+	if ((paramIdx < 0) || (paramIdx >= PREPARED_MAX_PARAMS)) {
+		return false;
+	}
+	if (paramIdx >= (int) params.size()) {
+		params.resize(paramIdx + 1);
+	}
+	SQL_Value &param = params[paramIdx];
+	free(param.str);
+	param = value;
+	if (value.str != NULL) {
+		param.str = (char*) malloc(sizeof(char) * value.len);
+		memcpy(param.str, value.str, value.len);
+	}
+	return true;
+}
+
+void SQL_Prepared::copyParams(std::vector<SQL_Value> &dest) {
+	dest = params;
+	for (int i = 0, size = dest.size(); i != size; ++i) {
+		if (dest[i].str != NULL) {
+			dest[i].str = (char*) malloc(sizeof(char) * dest[i].len);
+			memcpy(dest[i].str, params[i].str, params[i].len);
+		}
+	}
+}
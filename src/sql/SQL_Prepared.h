@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "sql.h"
+#include "SQL_Value.h"
+
+/**
+ * A prepared statement: a query with placeholders and the parameters bound
+ * to them. It is prepared on the server the first time it is executed on
+ * each connection of the pool.
+ */
+class SQL_Prepared {
+
+	public:
+
+		/**
+		 * The unique ID of this prepared statement.
+		 */
+		int id;
+
+		/**
+		 * The AMX machine owning this prepared statement.
+		 */
+		AMX *amx;
+
+		/**
+		 * The ID of the SQL connection owning this prepared statement.
+		 */
+		int connectionId;
+
+		/**
+		 * The query.
+		 */
+		char *query;
+
+		/**
+		 * The parameters bound so far.
+		 */
+		std::vector<SQL_Value> params;
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Prepared(int id, AMX *amx, int connectionId);
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Prepared();
+
+		/**
+		 * Binds a value to a parameter. The string (if any) is copied.
+		 * @param paramIdx
+		 * @param value
+		 * @return `false` if the index is invalid.
+		 */
+		bool bind(int paramIdx, const SQL_Value &value);
+
+		/**
+		 * Copies the bound parameters (used when the statement is executed,
+		 * so the parameters may be bound again right away).
+		 * @param dest
+		 */
+		void copyParams(std::vector<SQL_Value> &dest);
+};
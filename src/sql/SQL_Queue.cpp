@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "../Clock.h"
+
+#include "SQL_Statement.h"
+
+#include "SQL_Queue.h"
+
+/**
+ * The number of statements a lane may dequeue in a round.
+ */
+static const int LANE_WEIGHTS[STATEMENT_PRIORITY_COUNT] = {
+	STATEMENT_PRIORITY_HIGH_WEIGHT,
+	STATEMENT_PRIORITY_NORMAL_WEIGHT,
+	STATEMENT_PRIORITY_LOW_WEIGHT
+};
+
+SQL_Queue::SQL_Queue() : count(0) {
+	for (int i = 0; i != STATEMENT_PRIORITY_COUNT; ++i) {
+		executed[i] = 0;
+		totalWait[i] = 0;
+		maxWait[i] = 0;
+		credits[i] = LANE_WEIGHTS[i];
+	}
+}
+
+SQL_Queue::~SQL_Queue() {
+
+}
+
+int SQL_Queue::getLane(int flags) {
+	if (flags & STATEMENT_FLAGS_PRIORITY_HIGH) {
+		return STATEMENT_PRIORITY_HIGH;
+	}
+	if (flags & STATEMENT_FLAGS_PRIORITY_LOW) {
+		return STATEMENT_PRIORITY_LOW;
+	}
+	return STATEMENT_PRIORITY_NORMAL;
+}
+
+void SQL_Queue::push(SQL_Statement *stmt) {
+	mutex.lock();
+	lanes[getLane(stmt->flags)].push_back(stmt);
+	++count;
+	mutex.unlock();
+}
+
+bool SQL_Queue::pop(SQL_Statement *&stmt) {
+	if (count == 0) {
+		return false;
+	}
+	mutex.lock();
+	int lane = -1;
+	for (int round = 0; (lane == -1) && (round != 2); ++round) {
+		for (int i = 0; i != STATEMENT_PRIORITY_COUNT; ++i) {
+			if ((credits[i] != 0) && (!lanes[i].empty())) {
+				lane = i;
+				break;
+			}
+		}
+		if (lane == -1) {
+			// Every non-empty lane used its credits, a new round begins.
+			for (int i = 0; i != STATEMENT_PRIORITY_COUNT; ++i) {
+				credits[i] = LANE_WEIGHTS[i];
+			}
+		}
+	}
+	if (lane != -1) {
+		stmt = lanes[lane].front();
+		lanes[lane].pop_front();
+		--credits[lane];
+		--count;
+		unsigned long long wait = Clock::now() - stmt->queuedAt;
+		++executed[lane];
+		totalWait[lane] += wait;
+		if (wait > maxWait[lane]) {
+			maxWait[lane] = wait;
+		}
+	}
+	mutex.unlock();
+	return lane != -1;
+}
+
+bool SQL_Queue::remove(SQL_Statement *stmt) {
+	bool ret = false;
+	mutex.lock();
+	std::deque<SQL_Statement*> &lane = lanes[getLane(stmt->flags)];
+	std::deque<SQL_Statement*>::iterator it = std::find(lane.begin(), lane.end(), stmt);
+	if (it != lane.end()) {
+		lane.erase(it);
+		--count;
+		ret = true;
+	}
+	mutex.unlock();
+	return ret;
+}
+
+bool SQL_Queue::popOldest(SQL_Statement *&stmt, int lane) {
+	bool ret = false;
+	mutex.lock();
+	for (int i = STATEMENT_PRIORITY_COUNT - 1; (!ret) && (i >= lane); --i) {
+		for (std::deque<SQL_Statement*>::iterator it = lanes[i].begin(), end = lanes[i].end(); it != end; ++it) {
+			if (!((*it)->flags & STATEMENT_FLAGS_UNDROPPABLE)) {
+				stmt = *it;
+				lanes[i].erase(it);
+				--count;
+				ret = true;
+				break;
+			}
+		}
+	}
+	mutex.unlock();
+	return ret;
+}
+
+bool SQL_Queue::steal(SQL_Statement *&stmt) {
+	bool ret = false;
+	mutex.lock();
+	for (int i = STATEMENT_PRIORITY_COUNT - 1; (!ret) && (i >= 0); --i) {
+		for (std::deque<SQL_Statement*>::reverse_iterator it = lanes[i].rbegin(), end = lanes[i].rend(); it != end; ++it) {
+			if (!((*it)->flags & STATEMENT_FLAGS_UNDROPPABLE)) {
+				stmt = *it;
+				lanes[i].erase(--it.base());
+				--count;
+				ret = true;
+				break;
+			}
+		}
+	}
+	mutex.unlock();
+	return ret;
+}
+
+bool SQL_Queue::empty() {
+	return count == 0;
+}
+
+int SQL_Queue::size(int lane) {
+	mutex.lock();
+	int ret = lanes[lane].size();
+	mutex.unlock();
+	return ret;
+}
+
+int SQL_Queue::size() {
+	return count;
+}
+
+unsigned long long SQL_Queue::oldest() {
+	unsigned long long ret = 0;
+	mutex.lock();
+	for (int i = 0; i != STATEMENT_PRIORITY_COUNT; ++i) {
+		if ((!lanes[i].empty()) && ((ret == 0) || (lanes[i].front()->queuedAt < ret))) {
+			ret = lanes[i].front()->queuedAt;
+		}
+	}
+	mutex.unlock();
+	return ret;
+}
+
+void SQL_Queue::lock() {
+	mutex.lock();
+}
+
+void SQL_Queue::unlock() {
+	mutex.unlock();
+}
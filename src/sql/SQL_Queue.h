@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include "sql.h"
+
+#include "../Mutex.h"
+
+/**
+ * The queue of statements scheduled on a connection.
+ *
+ * Each priority has its own lane. Lanes are drained by weighted round robin,
+ * so a burst of statements in a higher lane cannot starve the lower ones.
+ */
+class SQL_Queue {
+
+	public:
+
+		/**
+		 * The number of statements executed from each lane.
+		 */
+		int executed[STATEMENT_PRIORITY_COUNT];
+
+		/**
+		 * The total time spent in queue by the executed statements of each
+		 * lane (microseconds).
+		 */
+		unsigned long long totalWait[STATEMENT_PRIORITY_COUNT];
+
+		/**
+		 * The longest time spent in queue by a statement of each lane
+		 * (microseconds).
+		 */
+		unsigned long long maxWait[STATEMENT_PRIORITY_COUNT];
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Queue();
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Queue();
+
+		/**
+		 * Gets the lane of a statement based on its flags.
+		 * @param flags
+		 * @return
+		 */
+		static int getLane(int flags);
+
+		/**
+		 * Pushes a statement at the end of its lane.
+		 * @param stmt
+		 */
+		void push(SQL_Statement *stmt);
+
+		/**
+		 * Pops the next statement that has to be executed.
+		 * @param stmt
+		 * @return `true` if a statement was popped, `false` if the queue is empty.
+		 */
+		bool pop(SQL_Statement *&stmt);
+
+		/**
+		 * Removes a statement that was not popped yet.
+		 * @param stmt
+		 * @return `true` if the statement was removed, `false` if it is not
+		 *         in the queue anymore.
+		 */
+		bool remove(SQL_Statement *stmt);
+
+		/**
+		 * Pops the oldest statement of the lowest priority lane, skipping the
+		 * lanes with a higher priority than `lane` and the statements flagged
+		 * `STATEMENT_FLAGS_UNDROPPABLE`.
+		 * @param stmt
+		 * @param lane
+		 * @return `true` if a statement was popped.
+		 */
+		bool popOldest(SQL_Statement *&stmt, int lane);
+
+		/**
+		 * Pops the statement that would be executed last (the newest one of
+		 * the lowest priority lane), skipping the statements flagged
+		 * `STATEMENT_FLAGS_UNDROPPABLE`.
+		 * @param stmt
+		 * @return `true` if a statement was popped.
+		 */
+		bool steal(SQL_Statement *&stmt);
+
+		/**
+		 * Checks if the queue is empty.
+		 * @return
+		 */
+		bool empty();
+
+		/**
+		 * Gets the number of statements waiting in a lane.
+		 * @param lane
+		 * @return
+		 */
+		int size(int lane);
+
+		/**
+		 * Gets the number of statements waiting in all lanes.
+		 * @return
+		 */
+		int size();
+
+		/**
+		 * Gets the moment the oldest waiting statement was queued.
+		 * @return Microseconds or 0 if the queue is empty.
+		 */
+		unsigned long long oldest();
+
+		/**
+		 * Locks the queue (used for reading consistent statistics).
+		 */
+		void lock();
+
+		/**
+		 * Unlocks the queue.
+		 */
+		void unlock();
+
+	private:
+
+		/**
+		 * Guards the lanes, the credits and the statistics.
+		 */
+		Mutex mutex;
+
+		/**
+		 * The total number of statements waiting in all lanes.
+		 */
+		boost::atomic<int> count;
+
+		/**
+		 * The lanes, from the highest priority to the lowest.
+		 */
+		std::deque<SQL_Statement*> lanes[STATEMENT_PRIORITY_COUNT];
+
+		/**
+		 * The number of statements each lane may still dequeue in this round.
+		 */
+		int credits[STATEMENT_PRIORITY_COUNT];
+};
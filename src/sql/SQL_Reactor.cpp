@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../Logger.h"
+
+#include "SQL_Connection.h"
+#include "SQL_Dispatcher.h"
+#include "SQL_Executor.h"
+#include "SQL_Statement.h"
+
+#include "SQL_Reactor.h"
+
+#ifndef _WIN32
+
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <unistd.h>
+
+	volatile bool SQL_Reactor::isActive = false;
+
+	int SQL_Reactor::epoll = -1;
+
+	int SQL_Reactor::doorbell = -1;
+
+	Mutex SQL_Reactor::mutex;
+
+	std::vector<SQL_Connection*> SQL_Reactor::submitted;
+
+	pthread_t SQL_Reactor::thread;
+
+	void SQL_Reactor::start() {
+		if (isActive) {
+			return;
+		}
+		epoll = epoll_create(REACTOR_MAX_EVENTS);
+		doorbell = eventfd(0, EFD_NONBLOCK);
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		epoll_ctl(epoll, EPOLL_CTL_ADD, doorbell, &event);
+		isActive = true;
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&thread, &attr, &worker, NULL);
+		pthread_attr_destroy(&attr);
+	}
+
+	void SQL_Reactor::stop() {
+		if (!isActive) {
+			return;
+		}
+		isActive = false;
+		eventfd_write(doorbell, 1);
+		void *status;
+		pthread_join(thread, &status);
+		close(doorbell);
+		close(epoll);
+	}
+
+	void SQL_Reactor::submit(SQL_Connection *conn) {
+		mutex.lock();
+		submitted.push_back(conn);
+		mutex.unlock();
+		eventfd_write(doorbell, 1);
+	}
+
+	void SQL_Reactor::next(SQL_Connection *conn) {
+		for (;;) {
+			conn->state = CONNECTION_STATE_RUNNING;
+			SQL_Statement *stmt = NULL;
+			while ((conn->isActive) && (conn->pending.pop(stmt))) {
+				if (stmt->flags & (STATEMENT_FLAGS_STREAMED | STATEMENT_FLAGS_COPY | STATEMENT_FLAGS_TRANSACTION)) {
+					// Streamed statements wait for the script between chunks,
+					// copies send their rows after the query and transactions
+					// may have to be rolled back and retried, so they can't
+					// be multiplexed. They are executed by the executor, so
+					// the other connections aren't blocked meanwhile.
+					Logger::log(LOG_DEBUG, "SQL_Reactor: Handing query off to the executor (conn->id = %d, stmt->id = %d)...", conn->id, stmt->id);
+					conn->handoff = stmt;
+					SQL_Executor::submit(conn);
+					return;
+				}
+				Logger::log(LOG_DEBUG, "SQL_Reactor: Sending query (conn->id = %d, stmt->id = %d, stmt->query = %s)...", conn->id, stmt->id, stmt->query);
+				// Once executed, the statement may be freed by the main thread.
+				int id = stmt->id;
+				if ((conn->begin(stmt)) && (conn->sendStatement(stmt))) {
+					struct epoll_event event;
+					event.events = EPOLLIN | EPOLLOUT;
+					event.data.ptr = conn;
+					epoll_ctl(epoll, EPOLL_CTL_ADD, conn->getSocket(), &event);
+					return;
+				}
+				conn->end(stmt);
+				complete(conn, id);
+			}
+			// Once released, the connection may be destroyed by the main
+			// thread, so it must not be touched unless it has to be resumed.
+			if (!conn->release()) {
+				return;
+			}
+		}
+	}
+
+	void SQL_Reactor::poll(SQL_Connection *conn) {
+		SQL_Statement *stmt = conn->executing;
+		int socket = conn->getSocket();
+		int ret = conn->pollStatement(stmt);
+		if (ret != ASYNC_DONE) {
+			struct epoll_event event;
+			event.events = ret == ASYNC_WRITING ? EPOLLIN | EPOLLOUT : EPOLLIN;
+			event.data.ptr = conn;
+			epoll_ctl(epoll, EPOLL_CTL_MOD, socket, &event);
+			return;
+		}
+		epoll_ctl(epoll, EPOLL_CTL_DEL, socket, NULL);
+		int id = stmt->id;
+		conn->end(stmt);
+		complete(conn, id);
+		next(conn);
+	}
+
+	void SQL_Reactor::complete(SQL_Connection *conn, int id) {
+		SQL_Dispatcher::push(id);
+		--conn->pendingCount;
+		SQL_Executor::completed.set();
+	}
+
+	void *SQL_Reactor::worker(void *param) {
+		struct epoll_event events[REACTOR_MAX_EVENTS];
+		std::vector<SQL_Connection*> conns;
+		while (isActive) {
+			int count = epoll_wait(epoll, events, REACTOR_MAX_EVENTS, -1);
+			for (int i = 0; i < count; ++i) {
+				if (events[i].data.ptr == NULL) {
+					eventfd_t value;
+					eventfd_read(doorbell, &value);
+				} else {
+					poll((SQL_Connection*) events[i].data.ptr);
+				}
+			}
+			mutex.lock();
+			conns.swap(submitted);
+			mutex.unlock();
+			for (int i = 0, size = conns.size(); i != size; ++i) {
+				next(conns[i]);
+			}
+			conns.clear();
+		}
+		return NULL;
+	}
+
+#endif
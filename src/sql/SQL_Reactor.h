@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "sql.h"
+
+#include "../Mutex.h"
+
+#ifndef _WIN32
+
+	#include "pthread.h"
+
+	/**
+	 * Executes the statements of asynchronous connections from a single
+	 * thread. The connection sends a statement without waiting for its result;
+	 * the reactor waits (with epoll) until the server answers and lets the
+	 * connection read the result. Many statements can be in flight at the same
+	 * time without a thread for each of them.
+	 */
+	class SQL_Reactor {
+
+		public:
+
+			/**
+			 * Starts the reactor thread.
+			 */
+			static void start();
+
+			/**
+			 * Stops the reactor thread.
+			 */
+			static void stop();
+
+			/**
+			 * Starts executing the statements queued on a connection.
+			 * @param conn
+			 */
+			static void submit(SQL_Connection *conn);
+
+		/**
+		 * Static class.
+		 */
+		private:
+
+			/**
+			 * `true` if the reactor thread is active, `false` otherwise.
+			 */
+			static volatile bool isActive;
+
+			/**
+			 * The epoll instance.
+			 */
+			static int epoll;
+
+			/**
+			 * An event file descriptor used to wake up the reactor thread.
+			 */
+			static int doorbell;
+
+			/**
+			 * Guards `submitted`.
+			 */
+			static Mutex mutex;
+
+			/**
+			 * The connections submitted since the last iteration.
+			 */
+			static std::vector<SQL_Connection*> submitted;
+
+			/**
+			 * UNIX thread.
+			 */
+			static pthread_t thread;
+
+			/**
+			 * Starts the next statement of a connection or releases it if
+			 * there are none left.
+			 * @param conn
+			 */
+			static void next(SQL_Connection *conn);
+
+			/**
+			 * Lets a connection process the answer of the server.
+			 * @param conn
+			 */
+			static void poll(SQL_Connection *conn);
+
+			/**
+			 * Reports an executed statement.
+			 * @param conn
+			 * @param id
+			 */
+			static void complete(SQL_Connection *conn, int id);
+
+			/**
+			 * The main loop of the reactor thread.
+			 * @param param
+			 */
+			static void *worker(void *param);
+
+			/**
+			 * Constructor.
+			 */
+			SQL_Reactor();
+
+			/**
+			 * Destructor.
+			 */
+			~SQL_Reactor();
+	};
+
+#endif
@@ -23,6 +23,9 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdlib>
+#include <cstring>
+
 #include "SQL_ResultSet.h"
 
 SQL_ResultSet::SQL_ResultSet() {
@@ -42,4 +45,20 @@ SQL_ResultSet::~SQL_ResultSet() {
 			free(cache[i][j].first);
 		}
 	}
+	for (int i = 0, size = values.size(); i != size; ++i) {
+		for (int j = 0, size = values[i].size(); j != size; ++j) {
+			free(values[i][j].str);
+		}
+	}
+}
+
+void SQL_ResultSet::copyFields(SQL_ResultSet *src) {
+	numFields = src->numFields;
+	fieldNames.resize(numFields);
+	for (int i = 0; i != numFields; ++i) {
+		int len = src->fieldNames[i].second;
+		fieldNames[i].first = (char*) malloc(sizeof(char) * len);
+		memcpy(fieldNames[i].first, src->fieldNames[i].first, len);
+		fieldNames[i].second = len;
+	}
 }
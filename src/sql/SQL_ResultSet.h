@@ -26,6 +26,7 @@
 #pragma once
 
 #include "sql.h"
+#include "SQL_Value.h"
 
 /**
  * An abstract SQL result set.
@@ -44,6 +45,13 @@ class SQL_ResultSet {
 		 */
 		virtual ~SQL_ResultSet();
 		
+		/**
+		 * Copies the names of the fields of another result set (the next
+		 * chunk of a streamed result has the same fields).
+		 * @param src
+		 */
+		void copyFields(SQL_ResultSet *src);
+		
 		/**
 		 * Insert ID.
 		 */
@@ -78,4 +86,9 @@ class SQL_ResultSet {
 		 * A cached copy of the result set.
 		 */
 		std::vector<std::vector<std::pair<char*, int> > > cache;
+		
+		/**
+		 * A typed copy of the result set (if it was fetched in binary form).
+		 */
+		std::vector<std::vector<SQL_Value> > values;
 };
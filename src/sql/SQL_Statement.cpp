@@ -23,32 +23,52 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "SQL_Dispatcher.h"
+#include "SQL_Watchdog.h"
+
 #include "SQL_Statement.h"
 
-SQL_Statement::SQL_Statement(int id, AMX *amx, int connectionId) {
+SQL_Statement::SQL_Statement(int id, AMX *amx, int connectionId) : status(STATEMENT_STATUS_NONE), cancelError(0), chunkState(CHUNK_STATE_NONE) {
 	this->id = id;
 	this->amx = amx;
 	this->connectionId = connectionId;
 	flags = STATEMENT_FLAGS_NONE;
-	status = STATEMENT_STATUS_NONE;
+	queuedAt = 0;
+	conn = NULL;
+	timeout = 0;
+	timerSlot = -1;
+	timerRounds = 0;
 	lastResultIdx = 0;
 	query = NULL;
+	isPrepared = false;
+	data = NULL;
+	dataLen = 0;
 	callback = NULL;
 	format = NULL;
 	error = 0;
 	errorMsg = NULL;
+	errorCopy = NULL;
+	chunkIdx = 0;
 }
 
 SQL_Statement::~SQL_Statement() {
+	if (timeout != 0) {
+		SQL_Watchdog::remove(this);
+	}
 	free(query);
 	free(callback);
 	free(format);
+	free(data);
+	free(errorCopy);
 	for (int i = 0, size = paramsArr.size(); i != size; ++i) {
 		free(paramsArr[i].first);
 	}
 	for (int i = 0, size = paramsStr.size(); i != size; ++i) {
 		free(paramsStr[i]);
 	}
+	for (int i = 0, size = bindings.size(); i != size; ++i) {
+		free(bindings[i].str);
+	}
 	for (int i = 0, size = resultSets.size(); i != size; ++i) {
 		delete resultSets[i];
 	}
@@ -87,6 +107,10 @@ int SQL_Statement::executeCallback() {
 						case 'F':
 							amx_Push(amx, paramsC[--c_idx]);
 							break;
+						case 'k':
+						case 'K':
+							amx_Push(amx, chunkIdx);
+							break;
 						case 'r':
 						case 'R':
 							amx_Push(amx, id);
@@ -119,3 +143,35 @@ int SQL_Statement::executeCallback() {
 	}
 	return ret;
 }
+
+void SQL_Statement::fail(int error) {
+	this->error = error;
+	errorMsg = getErrorMessage(error);
+	status = STATEMENT_STATUS_EXECUTED;
+	SQL_Dispatcher::push(id);
+}
+
+void SQL_Statement::copyError() {
+	if ((errorMsg == NULL) || (errorMsg == errorCopy)) {
+		return;
+	}
+	char *copy = (char*) malloc(sizeof(char) * (strlen(errorMsg) + 1));
+	strcpy(copy, errorMsg);
+	free(errorCopy);
+	errorCopy = copy;
+	errorMsg = errorCopy;
+}
+
+const char *SQL_Statement::getErrorMessage(int error) {
+	switch (error) {
+		case STATEMENT_ERROR_TIMEOUT:
+			return "Query timed out.";
+		case STATEMENT_ERROR_CANCELLED:
+			return "Query cancelled.";
+		case STATEMENT_ERROR_QUEUE_FULL:
+			return "Query queue is full.";
+		case STATEMENT_ERROR_BUSY:
+			return "Connection is busy with a streamed query.";
+	}
+	return "";
+}
@@ -27,8 +27,11 @@
 
 #include <vector>
 
+#include "../Event.h"
+
 #include "sql.h"
 #include "SQL_ResultSet.h"
+#include "SQL_Value.h"
 
 /**
  * An abstract SQL statement.
@@ -58,9 +61,39 @@ class SQL_Statement {
 		int flags;
 		
 		/**
-		 * SQL's statement status.
+		 * SQL's statement status (`STATEMENT_STATUS_*`). It only moves forward:
+		 * the main thread queues the statement, a worker executes it and the
+		 * main thread processes it.
+		 */
+		boost::atomic<int> status;
+		
+		/**
+		 * The moment this statement was scheduled for execution (microseconds).
+		 */
+		unsigned long long queuedAt;
+		
+		/**
+		 * The member of the pool this statement was scheduled on.
+		 */
+		SQL_Connection *conn;
+		
+		/**
+		 * The maximum time this statement may spend in queue and in execution
+		 * (milliseconds, 0 = no limit).
+		 */
+		int timeout;
+		
+		/**
+		 * The slot of the watchdog's timer wheel this statement is in (-1 if
+		 * none) and the number of rotations left before it expires.
 		 */
-		int status;
+		int timerSlot, timerRounds;
+		
+		/**
+		 * The reason this statement was cancelled (`STATEMENT_ERROR_*`, 0 if
+		 * it was not).
+		 */
+		boost::atomic<int> cancelError;
 		
 		/** 
 		 * Last result fetched.
@@ -71,6 +104,26 @@ class SQL_Statement {
 		 * SQL query.
 		 */
 		char *query;
+		
+		/**
+		 * `true` if the query is executed as a prepared statement.
+		 */
+		bool isPrepared;
+		
+		/**
+		 * The parameters bound to the prepared statement.
+		 */
+		std::vector<SQL_Value> bindings;
+		
+		/**
+		 * The rows sent after the query (`COPY ... FROM STDIN`).
+		 */
+		char *data;
+		
+		/**
+		 * The length of `data`.
+		 */
+		int dataLen;
 
 		/**
 		 * The PAWN callback.
@@ -92,6 +145,11 @@ class SQL_Statement {
 		 */
 		const char *errorMsg;
 		
+		/**
+		 * A copy of the error message (`errorMsg` points to it, if set).
+		 */
+		char *errorCopy;
+		
 		/**
 		 * The list of array parameters.
 		 */
@@ -112,6 +170,23 @@ class SQL_Statement {
 		 */
 		std::vector<SQL_ResultSet*> resultSets;
 		
+		/**
+		 * The index of the chunk of a streamed result (`QUERY_STREAMED`).
+		 */
+		int chunkIdx;
+		
+		/**
+		 * The state of the chunk held by `resultSets` (`CHUNK_STATE_*`). Only
+		 * the final chunk is delivered as an executed statement; the others
+		 * are passed to the main thread while the statement is executing.
+		 */
+		boost::atomic<int> chunkState;
+		
+		/**
+		 * Signaled when the callback of a chunk was executed.
+		 */
+		Event chunkDone;
+		
 		/**
 		 * Constructor.
 		 */
@@ -126,4 +201,24 @@ class SQL_Statement {
 		 * Executes the PAWN callback.
 		 */
 		int executeCallback();
+		
+		/**
+		 * Marks this statement as executed with a plugin error, without
+		 * executing it, and queues it to be processed by the main thread.
+		 * @param error `STATEMENT_ERROR_*`
+		 */
+		void fail(int error);
+		
+		/**
+		 * Copies the error message, so it's still valid after the connection
+		 * or the result it belongs to is reused.
+		 */
+		void copyError();
+		
+		/**
+		 * Gets the message of a plugin error.
+		 * @param error `STATEMENT_ERROR_*`
+		 * @return
+		 */
+		static const char *getErrorMessage(int error);
 };
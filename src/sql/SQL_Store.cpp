@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../Clock.h"
+#include "../Logger.h"
+
+#include "SQL_Connection.h"
+#include "SQL_Pools.h"
+#include "SQL_Statement.h"
+
+#include "SQL_Store.h"
+
+SQL_Store::SQL_Store(int id, AMX *amx, int connectionId, const char *table, const char *key, bool isUpsert) {
+	this->id = id;
+	this->amx = amx;
+	this->connectionId = connectionId;
+	this->table = (char*) malloc(sizeof(char) * (strlen(table) + 1));
+	strcpy(this->table, table);
+	this->key = (char*) malloc(sizeof(char) * (strlen(key) + 1));
+	strcpy(this->key, key);
+	this->isUpsert = isUpsert;
+	interval = STORE_DEFAULT_INTERVAL;
+	lastFlush = Clock::now();
+}
+
+SQL_Store::~SQL_Store() {
+	clear();
+	free(table);
+	free(key);
+}
+
+void SQL_Store::set(const char *key, const char *column, const SQL_Value &value) {
+	// The previous value of the column is overwritten: only the last one
+	// is written to the database.
+	SQL_Value &dest = rows[key][column];
+	free(dest.str);
+	dest = value;
+	if (value.str != NULL) {
+		dest.str = (char*) malloc(sizeof(char) * value.len);
+		memcpy(dest.str, value.str, value.len);
+	}
+}
+
+bool SQL_Store::isDue() {
+	return (!rows.empty()) && (Clock::elapsed(lastFlush) >= interval);
+}
+
+int SQL_Store::flush() {
+	lastFlush = Clock::now();
+	if ((rows.empty()) || (!SQL_Pools::isValidConnection(connectionId))) {
+		return 0;
+	}
+	SQL_Connection *conn = SQL_Pools::connections[connectionId];
+	int count = 0;
+	for (rowsMap_t::iterator it = rows.begin(), end = rows.end(); it != end; ++it) {
+		SQL_Statement *stmt = SQL_Pools::newStatement(amx, connectionId);
+		if (stmt == NULL) {
+			break;
+		}
+		// The values are handed over to the statement; the key is bound last.
+		std::vector<const char*> columns;
+		for (columnsMap_t::iterator col = it->second.begin(), colEnd = it->second.end(); col != colEnd; ++col) {
+			columns.push_back(col->first.c_str());
+			stmt->bindings.push_back(col->second);
+			col->second.str = NULL;
+		}
+		SQL_Value value;
+		value.type = VALUE_TYPE_STRING;
+		value.len = it->first.length() + 1;
+		value.str = (char*) malloc(sizeof(char) * value.len);
+		memcpy(value.str, it->first.c_str(), value.len);
+		stmt->bindings.push_back(value);
+		stmt->query = conn->getWriteCommand(table, key, columns, isUpsert);
+		stmt->isPrepared = true;
+		stmt->callback = (char*) calloc(1, sizeof(char));
+		stmt->format = (char*) calloc(1, sizeof(char));
+		// The row is no longer dirty, so the write can't be dropped to make
+		// room in the queue.
+		stmt->flags = STATEMENT_FLAGS_THREADED | STATEMENT_FLAGS_UNDROPPABLE;
+		SQL_Pools::statements[stmt->id] = stmt;
+		// The writes of a store are executed in order by the first member of
+		// the pool, so an older value can't overwrite a newer one.
+		conn->schedule(stmt, conn->pool[0]);
+		++count;
+	}
+	Logger::log(LOG_DEBUG, "SQL_Store::flush: Sent %d rows (store->id = %d, store->table = %s).", count, id, table);
+	clear();
+	return count;
+}
+
+void SQL_Store::clear() {
+	for (rowsMap_t::iterator it = rows.begin(), end = rows.end(); it != end; ++it) {
+		for (columnsMap_t::iterator col = it->second.begin(), colEnd = it->second.end(); col != colEnd; ++col) {
+			free(col->second.str);
+		}
+	}
+	rows.clear();
+}
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "sql.h"
+#include "SQL_Value.h"
+
+/**
+ * A write-behind store of the rows of a table. The values set by the script
+ * are kept until the next flush, which sends one `UPDATE` (or upsert) per
+ * dirty row with the last value of each changed column.
+ */
+class SQL_Store {
+
+	public:
+
+		/**
+		 * The changed columns of a row, by name.
+		 */
+		typedef std::map<std::string, SQL_Value> columnsMap_t;
+
+		/**
+		 * The dirty rows, by primary key.
+		 */
+		typedef std::map<std::string, columnsMap_t> rowsMap_t;
+
+		/**
+		 * The unique ID of this store.
+		 */
+		int id;
+
+		/**
+		 * The AMX machine owning this store.
+		 */
+		AMX *amx;
+
+		/**
+		 * The ID of the SQL connection owning this store.
+		 */
+		int connectionId;
+
+		/**
+		 * The name of the table.
+		 */
+		char *table;
+
+		/**
+		 * The name of the primary key column.
+		 */
+		char *key;
+
+		/**
+		 * Whether missing rows are inserted.
+		 */
+		bool isUpsert;
+
+		/**
+		 * The time between two flushes (milliseconds).
+		 */
+		int interval;
+
+		/**
+		 * The moment of the last flush.
+		 */
+		unsigned long long lastFlush;
+
+		/**
+		 * The dirty rows.
+		 */
+		rowsMap_t rows;
+
+		/**
+		 * Constructor.
+		 * @param id
+		 * @param amx
+		 * @param connectionId
+		 * @param table
+		 * @param key
+		 * @param isUpsert
+		 */
+		SQL_Store(int id, AMX *amx, int connectionId, const char *table, const char *key, bool isUpsert);
+
+		/**
+		 * Destructor (unflushed values are lost).
+		 */
+		~SQL_Store();
+
+		/**
+		 * Sets the value of a column of a row, marking it as dirty.
+		 * @param key The primary key of the row.
+		 * @param column
+		 * @param value The value (it is copied).
+		 */
+		void set(const char *key, const char *column, const SQL_Value &value);
+
+		/**
+		 * Checks if there are dirty rows and the interval elapsed.
+		 * @return
+		 */
+		bool isDue();
+
+		/**
+		 * Sends the dirty rows (one threaded statement each).
+		 * @return The number of rows that were sent.
+		 */
+		int flush();
+
+	private:
+
+		/**
+		 * Frees the values of the dirty rows and forgets them.
+		 */
+		void clear();
+};
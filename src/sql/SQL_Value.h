@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "sql.h"
+
+/**
+ * A typed value: a field of a binary result set or a parameter bound to a
+ * prepared statement. The string is owned by the container of the value.
+ */
+struct SQL_Value {
+
+	/**
+	 * The type of the value (`VALUE_TYPE_*`).
+	 */
+	int type;
+
+	/**
+	 * The value, if it is an integer.
+	 */
+	long long i;
+
+	/**
+	 * The value, if it is a floating point number.
+	 */
+	double f;
+
+	/**
+	 * The value, if it is a string.
+	 */
+	char *str;
+
+	/**
+	 * The length of `str` (including the null terminator).
+	 */
+	int len;
+
+	/**
+	 * Constructor.
+	 */
+	SQL_Value() : type(VALUE_TYPE_NULL), i(0), f(0.0), str(NULL), len(0) {
+
+	}
+};
@@ -0,0 +1,299 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "../Clock.h"
+#include "../Logger.h"
+
+#include "SQL_Connection.h"
+#include "SQL_Executor.h"
+#include "SQL_Statement.h"
+
+#if defined PLUGIN_SUPPORTS_MYSQL
+	#include "mysql/mysql.h"
+#endif
+
+#include "SQL_Watchdog.h"
+
+volatile bool SQL_Watchdog::isActive = false;
+
+Event SQL_Watchdog::doorbell;
+
+Mutex SQL_Watchdog::mutex;
+
+Mutex SQL_Watchdog::interruptMutex;
+
+std::vector<SQL_Statement*> SQL_Watchdog::interrupts;
+
+std::vector<SQL_Statement*> SQL_Watchdog::wheel[WATCHDOG_SLOTS];
+
+int SQL_Watchdog::cursor = 0;
+
+int SQL_Watchdog::keepAliveIdle = KEEPALIVE_DEFAULT_IDLE;
+
+std::vector<SQL_Connection*> SQL_Watchdog::connections;
+
+#ifdef _WIN32
+	HANDLE SQL_Watchdog::thread;
+#else
+	pthread_t SQL_Watchdog::thread;
+#endif
+
+void SQL_Watchdog::start() {
+	if (isActive) {
+		return;
+	}
+	isActive = true;
+	#ifdef _WIN32
+		DWORD threadId = 0;
+		thread = CreateThread(NULL, NULL, (LPTHREAD_START_ROUTINE) worker, NULL, NULL, &threadId);
+	#else
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		pthread_create(&thread, &attr, &worker, NULL);
+		pthread_attr_destroy(&attr);
+	#endif
+}
+
+void SQL_Watchdog::stop() {
+	if (!isActive) {
+		return;
+	}
+	isActive = false;
+	doorbell.set();
+	#ifdef _WIN32
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	#else
+		void *status;
+		pthread_join(thread, &status);
+	#endif
+}
+
+void SQL_Watchdog::add(SQL_Statement *stmt, int timeout) {
+	int ticks = (timeout + WATCHDOG_RESOLUTION - 1) / WATCHDOG_RESOLUTION;
+	if (ticks < 1) {
+		ticks = 1;
+	}
+	mutex.lock();
+	stmt->timeout = timeout;
+	stmt->timerSlot = (cursor + ticks) % WATCHDOG_SLOTS;
+	stmt->timerRounds = (ticks - 1) / WATCHDOG_SLOTS;
+	wheel[stmt->timerSlot].push_back(stmt);
+	mutex.unlock();
+}
+
+void SQL_Watchdog::remove(SQL_Statement *stmt) {
+	mutex.lock();
+	if (stmt->timerSlot != -1) {
+		std::vector<SQL_Statement*> &slot = wheel[stmt->timerSlot];
+		std::vector<SQL_Statement*>::iterator it = std::find(slot.begin(), slot.end(), stmt);
+		if (it != slot.end()) {
+			*it = slot.back();
+			slot.pop_back();
+		}
+		stmt->timerSlot = -1;
+	}
+	std::vector<SQL_Statement*>::iterator it = std::find(interrupts.begin(), interrupts.end(), stmt);
+	if (it != interrupts.end()) {
+		interrupts.erase(it);
+	}
+	mutex.unlock();
+}
+
+bool SQL_Watchdog::cancel(SQL_Statement *stmt, int error) {
+	mutex.lock();
+	bool ret = cancelLocked(stmt, error);
+	mutex.unlock();
+	return ret;
+}
+
+bool SQL_Watchdog::cancelLocked(SQL_Statement *stmt, int error) {
+	if (stmt->status >= STATEMENT_STATUS_EXECUTED) {
+		return false;
+	}
+	int expected = 0;
+	if (!stmt->cancelError.compare_exchange_strong(expected, error)) {
+		return false;
+	}
+	SQL_Connection *conn = stmt->conn;
+	if (conn == NULL) {
+		// Not scheduled yet; `SQL_Connection::execute` skips it.
+		return true;
+	}
+	if ((stmt->status == STATEMENT_STATUS_QUEUED) && (conn->pending.remove(stmt))) {
+		Logger::log(LOG_DEBUG, "SQL_Watchdog::cancel: Statement removed from queue (stmt->id = %d, error = %d).", stmt->id, error);
+		if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+			--conn->streamedCount;
+		}
+		stmt->fail(error);
+		--conn->pendingCount;
+		SQL_Executor::completed.set();
+		return true;
+	}
+	// The statement is being executed (or is about to be, in which case
+	// `SQL_Connection::execute` notices the flag). It is interrupted by the
+	// watchdog thread, so the caller doesn't wait for the server.
+	interrupts.push_back(stmt);
+	doorbell.set();
+	return true;
+}
+
+void SQL_Watchdog::watch(SQL_Connection *conn) {
+	mutex.lock();
+	if (std::find(connections.begin(), connections.end(), conn) == connections.end()) {
+		connections.push_back(conn);
+	}
+	mutex.unlock();
+}
+
+void SQL_Watchdog::unwatch(SQL_Connection *conn) {
+	mutex.lock();
+	std::vector<SQL_Connection*>::iterator it = std::find(connections.begin(), connections.end(), conn);
+	if (it != connections.end()) {
+		connections.erase(it);
+	}
+	for (int i = 0; i != (int) interrupts.size(); ) {
+		if (interrupts[i]->conn == conn) {
+			interrupts.erase(interrupts.begin() + i);
+		} else {
+			++i;
+		}
+	}
+	mutex.unlock();
+	// Waits for the interrupts that are being sent.
+	interruptMutex.lock();
+	interruptMutex.unlock();
+}
+
+void SQL_Watchdog::keepAlive() {
+	if (keepAliveIdle == 0) {
+		return;
+	}
+	unsigned long long now = Clock::now();
+	std::vector<SQL_Connection*> idle;
+	mutex.lock();
+	for (int i = 0, size = connections.size(); i != size; ++i) {
+		SQL_Connection *conn = connections[i];
+		if ((!conn->isActive) || (now - conn->lastActivity < keepAliveIdle * 1000ULL)) {
+			continue;
+		}
+		// Once checked out, the connection can't be destroyed until released.
+		int expected = CONNECTION_STATE_IDLE;
+		if (conn->state.compare_exchange_strong(expected, CONNECTION_STATE_RUNNING)) {
+			idle.push_back(conn);
+		}
+	}
+	mutex.unlock();
+	for (int i = 0, size = idle.size(); i != size; ++i) {
+		SQL_Connection *conn = idle[i];
+		Logger::log(LOG_DEBUG, "SQL_Watchdog: Checking idle connection (conn->id = %d)...", conn->id);
+		if (!conn->keepAlive()) {
+			Logger::log(LOG_WARNING, "SQL_Watchdog: Connection lost (conn->id = %d).", conn->id);
+		}
+		conn->lastActivity = Clock::now();
+		if (conn->release()) {
+			conn->submit();
+		}
+	}
+}
+
+void SQL_Watchdog::interrupt() {
+	mutex.lock();
+	if (interrupts.empty()) {
+		mutex.unlock();
+		return;
+	}
+	std::vector<SQL_Statement*> stmts;
+	stmts.swap(interrupts);
+	std::vector<SQL_Connection*> conns;
+	for (int i = 0, size = stmts.size(); i != size; ++i) {
+		conns.push_back(stmts[i]->conn);
+	}
+	// The connections can't be destroyed until `interruptMutex` is released
+	// (@see unwatch). The statements might be freed meanwhile, but
+	// `SQL_Connection::cancel` only uses those that are still executing.
+	interruptMutex.lock();
+	mutex.unlock();
+	for (int i = 0, size = stmts.size(); i != size; ++i) {
+		conns[i]->cancel(stmts[i]);
+	}
+	interruptMutex.unlock();
+}
+
+void SQL_Watchdog::advance() {
+	mutex.lock();
+	std::vector<SQL_Statement*> &slot = wheel[cursor];
+	for (int i = 0; i < (int) slot.size(); ) {
+		SQL_Statement *stmt = slot[i];
+		if (stmt->timerRounds != 0) {
+			--stmt->timerRounds;
+			++i;
+			continue;
+		}
+		slot[i] = slot.back();
+		slot.pop_back();
+		stmt->timerSlot = -1;
+		if (cancelLocked(stmt, STATEMENT_ERROR_TIMEOUT)) {
+			Logger::log(LOG_WARNING, "SQL_Watchdog: Query timed out (stmt->id = %d, timeout = %d ms, stmt->query = %s).", stmt->id, stmt->timeout, stmt->query);
+		}
+	}
+	cursor = (cursor + 1) % WATCHDOG_SLOTS;
+	mutex.unlock();
+}
+
+#ifdef _WIN32
+DWORD WINAPI SQL_Watchdog::worker(LPVOID param) {
+#else
+void *SQL_Watchdog::worker(void *param) {
+#endif
+	#if defined PLUGIN_SUPPORTS_MYSQL
+		mysql_thread_init();
+	#endif
+	unsigned long long next = Clock::now() + WATCHDOG_RESOLUTION * 1000, lastCheck = Clock::now();
+	while (isActive) {
+		interrupt();
+		unsigned long long now = Clock::now();
+		if (now < next) {
+			doorbell.wait((int) ((next - now + 999) / 1000));
+			continue;
+		}
+		// Catching up if the thread was delayed.
+		while ((isActive) && (next <= now)) {
+			advance();
+			next += WATCHDOG_RESOLUTION * 1000;
+		}
+		if (now - lastCheck >= KEEPALIVE_CHECK_INTERVAL * 1000) {
+			keepAlive();
+			lastCheck = now;
+		}
+	}
+	#if defined PLUGIN_SUPPORTS_MYSQL
+		mysql_thread_end();
+	#endif
+	return 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "sql.h"
+
+#include "../Event.h"
+#include "../Mutex.h"
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include "pthread.h"
+#endif
+
+/**
+ * Enforces the timeouts of statements and keeps idle connections alive.
+ *
+ * Statements with a timeout are kept in a timer wheel: every slot covers
+ * `WATCHDOG_RESOLUTION` milliseconds and statements that expire more than a
+ * rotation later wait for the remaining rotations in their slot.
+ */
+class SQL_Watchdog {
+
+	public:
+
+		/**
+		 * The time after which an idle connection is checked (milliseconds,
+		 * 0 = never).
+		 */
+		static int keepAliveIdle;
+
+		/**
+		 * Starts the watchdog thread.
+		 */
+		static void start();
+
+		/**
+		 * Stops the watchdog thread.
+		 */
+		static void stop();
+
+		/**
+		 * Enforces a timeout on a statement that was not executed yet.
+		 * @param stmt
+		 * @param timeout Milliseconds.
+		 */
+		static void add(SQL_Statement *stmt, int timeout);
+
+		/**
+		 * Stops watching a statement (called before the statement is freed).
+		 * @param stmt
+		 */
+		static void remove(SQL_Statement *stmt);
+
+		/**
+		 * Cancels a statement. A queued statement is removed from its queue,
+		 * an executing one is interrupted by the watchdog thread. The
+		 * statement's callback is not called; `OnSQLError` is called instead.
+		 * @param stmt
+		 * @param error The reason (`STATEMENT_ERROR_*`).
+		 * @return `true` if the statement was cancelled, `false` if it was
+		 *         already executed.
+		 */
+		static bool cancel(SQL_Statement *stmt, int error);
+
+		/**
+		 * Starts checking a connection while it is idle.
+		 * @param conn
+		 */
+		static void watch(SQL_Connection *conn);
+
+		/**
+		 * Stops checking a connection (called before it is destroyed). Waits
+		 * if one of its statements is being interrupted.
+		 * @param conn
+		 */
+		static void unwatch(SQL_Connection *conn);
+
+	/**
+	 * Static class.
+	 */
+	private:
+
+		/**
+		 * `true` if the watchdog thread is active, `false` otherwise.
+		 */
+		static volatile bool isActive;
+
+		/**
+		 * Wakes up the watchdog thread when it has to stop or interrupt a
+		 * statement.
+		 */
+		static Event doorbell;
+
+		/**
+		 * Guards the wheel and the statements' timer fields.
+		 */
+		static Mutex mutex;
+
+		/**
+		 * Held while the interrupts are sent.
+		 */
+		static Mutex interruptMutex;
+
+		/**
+		 * The executing statements that have to be interrupted. Guarded by
+		 * `mutex`.
+		 */
+		static std::vector<SQL_Statement*> interrupts;
+
+		/**
+		 * The timer wheel.
+		 */
+		static std::vector<SQL_Statement*> wheel[WATCHDOG_SLOTS];
+
+		/**
+		 * The slot processed next.
+		 */
+		static int cursor;
+
+		/**
+		 * The connections checked while idle.
+		 */
+		static std::vector<SQL_Connection*> connections;
+
+		#ifdef _WIN32
+
+			/**
+			 * Win32 thread.
+			 */
+			static HANDLE thread;
+		#else
+
+			/**
+			 * UNIX thread.
+			 */
+			static pthread_t thread;
+		#endif
+
+		/**
+		 * Cancels a statement (the caller must hold `mutex`).
+		 * @param stmt
+		 * @param error
+		 * @return
+		 */
+		static bool cancelLocked(SQL_Statement *stmt, int error);
+
+		/**
+		 * Interrupts the cancelled statements that are being executed.
+		 */
+		static void interrupt();
+
+		/**
+		 * Expires the statements of the current slot and advances the cursor.
+		 */
+		static void advance();
+
+		/**
+		 * Checks the connections that were idle for too long. A connection is
+		 * checked out from the executor while it is checked.
+		 */
+		static void keepAlive();
+
+		/**
+		 * The main loop of the watchdog thread.
+		 * @param param
+		 */
+		#ifdef _WIN32
+			static DWORD WINAPI worker(LPVOID param);
+		#else
+			static void *worker(void *param);
+		#endif
+
+		/**
+		 * Constructor.
+		 */
+		SQL_Watchdog();
+
+		/**
+		 * Destructor.
+		 */
+		~SQL_Watchdog();
+};
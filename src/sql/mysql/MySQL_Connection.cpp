@@ -23,6 +23,11 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cctype>
+#include <cstdio>
+
+#include "../../Logger.h"
+
 #include "MySQL_Connection.h"
  
 #ifdef PLUGIN_SUPPORTS_MYSQL
@@ -33,13 +38,33 @@
 	MySQL_Connection::MySQL_Connection(int id, AMX *amx) : SQL_Connection(id, amx) {
 		type = PLUGIN_SUPPORTS_MYSQL;
 		mutex = new Mutex();
+		host = user = pass = NULL;
+		port = 0;
+		threadId = 0;
+		killer = NULL;
+		infile = NULL;
+		infilePos = 0;
+		preparedThreadId = 0;
+		lastErrorId = 0;
+		memset(lastError, 0, sizeof(lastError));
 		conn = mysql_init(NULL);
 		my_bool reconnect = true;
 		mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
+		// Bulk loads are sent with `LOAD DATA LOCAL INFILE`, their rows
+		// being read from memory by the handler below.
+		unsigned int localInfile = 1;
+		mysql_options(conn, MYSQL_OPT_LOCAL_INFILE, &localInfile);
+		mysql_set_local_infile_handler(conn, infileInit, infileRead, infileEnd, infileError, this);
 	}
 
 	MySQL_Connection::~MySQL_Connection() {
 		disconnect();
+		if (killer != NULL) {
+			mysql_close(killer);
+		}
+		free(host);
+		free(user);
+		free(pass);
 		delete mutex;
 	}
 
@@ -47,10 +72,43 @@
 		if (port == 0) {
 			port = MYSQL_DEFAULT_PORT;
 		}
-		return mysql_real_connect(conn, host, user, pass, db, port, NULL, CLIENT_MULTI_STATEMENTS) ? true : false;
+		// The credentials are kept for the connection used to interrupt queries
+		// (empty ones are NULL).
+		if (host != NULL) {
+			this->host = (char*) malloc(sizeof(char) * (strlen(host) + 1));
+			strcpy(this->host, host);
+		}
+		if (user != NULL) {
+			this->user = (char*) malloc(sizeof(char) * (strlen(user) + 1));
+			strcpy(this->user, user);
+		}
+		if (pass != NULL) {
+			this->pass = (char*) malloc(sizeof(char) * (strlen(pass) + 1));
+			strcpy(this->pass, pass);
+		}
+		this->port = port;
+		if (!mysql_real_connect(conn, host, user, pass, db, port, NULL, CLIENT_MULTI_STATEMENTS)) {
+			return false;
+		}
+		openKiller();
+		// The queries built by the plugin must fit in a packet (some room is
+		// left for the header of the packet).
+		if (!mysql_query(conn, "SELECT @@max_allowed_packet")) {
+			MYSQL_RES *result = mysql_store_result(conn);
+			MYSQL_ROW row;
+			if ((result != NULL) && ((row = mysql_fetch_row(result)) != NULL) && (row[0] != NULL)) {
+				long long maxPacket = atoll(row[0]) - MYSQL_PACKET_HEADROOM;
+				if (maxPacket < maxQueryLength) {
+					maxQueryLength = (int) maxPacket;
+				}
+			}
+			mysql_free_result(result);
+		}
+		return true;
 	}
 
 	void MySQL_Connection::disconnect() {
+		clearPrepared();
 		mysql_close(conn);
 	}
 
@@ -83,56 +141,629 @@
 	}
 
 	void MySQL_Connection::executeStatement(SQL_Statement *stmt) {
+		if (killer == NULL) {
+			// It was lost; it is opened again here so `interrupt` never blocks.
+			openKiller();
+		}
 		mutex->lock();
-		if ((!ping()) && (!mysql_query(conn, stmt->query))) {
+		if (stmt->isPrepared) {
+			executePrepared(stmt);
+			mutex->unlock();
+			return;
+		}
+		if (stmt->flags & STATEMENT_FLAGS_COPY) {
+			infile = stmt;
+		}
+		// The query is sent right away; the connection is only checked (and
+		// reestablished) if it turns out to be lost.
+		threadId = mysql_thread_id(conn);
+		bool isSuccess = !mysql_query(conn, stmt->query);
+		if ((!isSuccess) && ((mysql_errno(conn) == CR_SERVER_GONE_ERROR) || (mysql_errno(conn) == CR_SERVER_LOST))) {
+			Logger::log(LOG_WARNING, "MySQL_Connection::executeStatement: Connection lost, reconnecting (conn->id = %d)...", id);
+			if (!ping()) {
+				// The ID changes when the connection is reestablished.
+				threadId = mysql_thread_id(conn);
+				isSuccess = !mysql_query(conn, stmt->query);
+			}
+		}
+		if (isSuccess) {
 			stmt->error = 0;
-			do {
-				MySQL_ResultSet *r = new MySQL_ResultSet();
-				r->result = mysql_store_result(conn);
+			if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+				streamResults(stmt);
+			} else {
+				int status;
+				do {
+					storeResult(stmt);
+				} while ((status = mysql_next_result(conn)) == 0);
+				if (status > 0) {
+					// One of the following commands failed (the rest of them
+					// were skipped).
+					stmt->error = getErrorId();
+					stmt->errorMsg = getError();
+				}
+			}
+		} else {
+			stmt->error = getErrorId();
+			stmt->errorMsg = getError();
+		}
+		infile = NULL;
+		mutex->unlock();
+	}
+
+	void MySQL_Connection::rollback() {
+		mutex->lock();
+		mysql_query(conn, "ROLLBACK");
+		mutex->unlock();
+	}
+
+	bool MySQL_Connection::canRetry(SQL_Statement *stmt) {
+		// The whole transaction is rolled back by the server only after a
+		// deadlock (a lock wait timeout rolls back the last command only).
+		return stmt->error == ER_LOCK_DEADLOCK;
+	}
+
+	char *MySQL_Connection::getCopyCommand(const char *table, const char *columns) {
+		// The format of the rows is the same as the one of `COPY` (which is
+		// also the default one of `LOAD DATA`).
+		std::string command = "LOAD DATA LOCAL INFILE '" COPY_INFILE_NAME "' INTO TABLE ";
+		command += table;
+		command += " FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\' LINES TERMINATED BY '\\n'";
+		if ((columns != NULL) && (columns[0] != '\0')) {
+			command += " (";
+			command += columns;
+			command += ')';
+		}
+		char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+		strcpy(dest, command.c_str());
+		return dest;
+	}
+
+	char *MySQL_Connection::getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert) {
+		std::string command;
+		if (isUpsert) {
+			command = "INSERT INTO ";
+			command += table;
+			command += " (";
+			for (int i = 0, size = columns.size(); i != size; ++i) {
+				command += columns[i];
+				command += ", ";
+			}
+			command += key;
+			command += ") VALUES (";
+			for (int i = 0, size = columns.size(); i != size; ++i) {
+				command += "?, ";
+			}
+			command += "?) ON DUPLICATE KEY UPDATE ";
+			for (int i = 0, size = columns.size(); i != size; ++i) {
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += " = VALUES(";
+				command += columns[i];
+				command += ')';
+			}
+		} else {
+			command = "UPDATE ";
+			command += table;
+			command += " SET ";
+			for (int i = 0, size = columns.size(); i != size; ++i) {
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += " = ?";
+			}
+			command += " WHERE ";
+			command += key;
+			command += " = ?";
+		}
+		char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+		strcpy(dest, command.c_str());
+		return dest;
+	}
+
+	int MySQL_Connection::infileInit(void **ptr, const char *filename, void *userdata) {
+		MySQL_Connection *conn = (MySQL_Connection*) userdata;
+		*ptr = conn;
+		if ((conn->infile == NULL) || (strcmp(filename, COPY_INFILE_NAME) != 0)) {
+			Logger::log(LOG_WARNING, "MySQL_Connection::infileInit: The server requested a local file outside of a bulk load (conn->id = %d, filename = %s).", conn->id, filename);
+			return 1;
+		}
+		// The query is sent again if the connection was reestablished.
+		conn->infilePos = 0;
+		return 0;
+	}
+
+	int MySQL_Connection::infileRead(void *ptr, char *buf, unsigned int len) {
+		MySQL_Connection *conn = (MySQL_Connection*) ptr;
+		int n = conn->infile->dataLen - conn->infilePos;
+		if (n > (int) len) {
+			n = len;
+		}
+		memcpy(buf, conn->infile->data + conn->infilePos, n);
+		conn->infilePos += n;
+		return n;
+	}
+
+	void MySQL_Connection::infileEnd(void *ptr) {
+		// The rows are freed with their statement.
+	}
+
+	int MySQL_Connection::infileError(void *ptr, char *msg, unsigned int len) {
+		snprintf(msg, len, "Local files can only be read by bulk loads.");
+		return CR_UNKNOWN_ERROR;
+	}
+
+	void MySQL_Connection::storeResult(SQL_Statement *stmt) {
+		MySQL_ResultSet *r = new MySQL_ResultSet();
+		r->result = mysql_store_result(conn);
+		r->insertId = mysql_insert_id(conn);
+		r->affectedRows = mysql_affected_rows(conn);
+		if (r->result != NULL) {
+			r->numRows = mysql_num_rows(r->result);
+			r->numFields = mysql_num_fields(r->result);
+			r->fieldNames.resize(r->numFields);
+			MYSQL_FIELD *field;
+			for (int i = 0; field = mysql_fetch_field(r->result); ++i) {
+				int len = strlen(field->name) + 1;
+				r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
+				strcpy(r->fieldNames[i].first, field->name);
+				r->fieldNames[i].second = len;
+			}
+			if (stmt->flags & STATEMENT_FLAGS_CACHED) {
+				r->cache.reserve(r->numRows);
+				for (int i = 0; i != r->numRows; ++i) {
+					MYSQL_ROW row = mysql_fetch_row(r->result);
+					cacheRow(r, row, mysql_fetch_lengths(r->result));
+				}
+			} else {
+				r->lastRow = mysql_fetch_row(r->result);
+				r->lastRowLens = mysql_fetch_lengths(r->result);
+			}
+		}
+		stmt->resultSets.push_back(r);
+	}
+
+	void MySQL_Connection::streamResults(SQL_Statement *stmt) {
+		// Once discarded, the remaining rows are still read (the connection
+		// can't be used otherwise), but they are not kept.
+		bool isDiscarded = false;
+		do {
+			MYSQL_RES *result = mysql_use_result(conn);
+			// The last chunk of the previous result isn't the final one.
+			if ((!isDiscarded) && (!stmt->resultSets.empty()) && (!deliverChunk(stmt))) {
+				isDiscarded = true;
+			}
+			if (isDiscarded) {
+				if (result != NULL) {
+					mysql_free_result(result);
+				}
+				continue;
+			}
+			MySQL_ResultSet *r = new MySQL_ResultSet();
+			stmt->resultSets.push_back(r);
+			if (result == NULL) {
 				r->insertId = mysql_insert_id(conn);
 				r->affectedRows = mysql_affected_rows(conn);
-				if (r->result != NULL) {
-					r->numRows = mysql_num_rows(r->result);
-					r->numFields = mysql_num_fields(r->result);
-					r->fieldNames.resize(r->numFields);
-					MYSQL_FIELD *field;
-					for (int i = 0; field = mysql_fetch_field(r->result); ++i) {
-						int len = strlen(field->name) + 1;
-						r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
-						strcpy(r->fieldNames[i].first, field->name);
-						r->fieldNames[i].second = len;
+				continue;
+			}
+			r->numFields = mysql_num_fields(result);
+			r->fieldNames.resize(r->numFields);
+			MYSQL_FIELD *field;
+			for (int i = 0; field = mysql_fetch_field(result); ++i) {
+				int len = strlen(field->name) + 1;
+				r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
+				strcpy(r->fieldNames[i].first, field->name);
+				r->fieldNames[i].second = len;
+			}
+			MYSQL_ROW row;
+			while ((row = mysql_fetch_row(result)) != NULL) {
+				if (isDiscarded) {
+					continue;
+				}
+				if (r->numRows == streamChunk) {
+					MySQL_ResultSet *next = new MySQL_ResultSet();
+					next->copyFields(r);
+					if (!deliverChunk(stmt)) {
+						delete next;
+						isDiscarded = true;
+						continue;
 					}
-					if (stmt->flags & STATEMENT_FLAGS_CACHED) {
-						r->cache.resize(r->numRows);
-						for (int i = 0; i != r->numRows; ++i) {
-							r->cache[i].resize(r->numFields);
-							MYSQL_ROW row = mysql_fetch_row(r->result);
-							unsigned long *lengths = mysql_fetch_lengths(r->result);
-							for (int j = 0; j != r->numFields; ++j) {
-								if (lengths[j]) {
-									r->cache[i][j].first = (char*) malloc(sizeof(char) * (lengths[j] + 1));
-									strcpy(r->cache[i][j].first, row[j]);
-									r->cache[i][j].second = lengths[j] + 1;
-								} else {
-									r->cache[i][j].first = (char*) malloc(sizeof(char) * 5); // NULL + \0
-									strcpy(r->cache[i][j].first, "NULL");
-									r->cache[i][j].second = 5;
-								}
+					r = next;
+					stmt->resultSets.push_back(r);
+				}
+				cacheRow(r, row, mysql_fetch_lengths(result));
+				++r->numRows;
+			}
+			if ((!isDiscarded) && (mysql_errno(conn) != 0)) {
+				stmt->error = getErrorId();
+				stmt->errorMsg = getError();
+			}
+			mysql_free_result(result);
+		} while (mysql_next_result(conn) == 0);
+	}
+
+	void MySQL_Connection::cacheRow(SQL_ResultSet *r, MYSQL_ROW row, unsigned long *lengths) {
+		r->cache.push_back(std::vector<std::pair<char*, int> >(r->numFields));
+		std::vector<std::pair<char*, int> > &cells = r->cache.back();
+		for (int j = 0; j != r->numFields; ++j) {
+			if (lengths[j]) {
+				cells[j].first = (char*) malloc(sizeof(char) * (lengths[j] + 1));
+				strcpy(cells[j].first, row[j]);
+				cells[j].second = lengths[j] + 1;
+			} else {
+				cells[j].first = (char*) malloc(sizeof(char) * 5); // NULL + \0
+				strcpy(cells[j].first, "NULL");
+				cells[j].second = 5;
+			}
+		}
+	}
+
+	void MySQL_Connection::executeStatements(std::vector<SQL_Statement*> &stmts) {
+		for (int i = 0, size = stmts.size(); i != size; ) {
+			int count = 0, len = 0;
+			while ((i + count != size) && (canCoalesce(stmts[i + count])) && (len < MYSQL_BATCH_MAX_LENGTH)) {
+				len += strlen(stmts[i + count]->query) + 1;
+				++count;
+			}
+			if (count < 2) {
+				executeStatement(stmts[i]);
+				++i;
+			} else {
+				i += executeBatch(&stmts[i], count);
+			}
+		}
+	}
+
+	bool MySQL_Connection::canCoalesce(SQL_Statement *stmt) {
+		const char *query = stmt->query;
+		while (isspace((unsigned char) *query)) {
+			++query;
+		}
+		// Stored procedures return an extra result set.
+		return (!stmt->isPrepared) && (!(stmt->flags & (STATEMENT_FLAGS_STREAMED | STATEMENT_FLAGS_COPY | STATEMENT_FLAGS_INSERT))) && (isSingleCommand(query)) && (strncasecmp(query, "CALL", 4) != 0);
+	}
+
+	int MySQL_Connection::executeBatch(SQL_Statement **stmts, int count) {
+		std::string query;
+		for (int i = 0; i != count; ++i) {
+			if (i != 0) {
+				query += ';';
+			}
+			const char *end = strchr(stmts[i]->query, ';');
+			query.append(stmts[i]->query, end == NULL ? strlen(stmts[i]->query) : end - stmts[i]->query);
+		}
+		mutex->lock();
+		Logger::log(LOG_DEBUG, "MySQL_Connection::executeBatch: Sending %d statements (conn->id = %d)...", count, id);
+		threadId = mysql_thread_id(conn);
+		if (mysql_real_query(conn, query.c_str(), query.length())) {
+			// The first statement failed; the others are sent again.
+			if ((mysql_errno(conn) == CR_SERVER_GONE_ERROR) || (mysql_errno(conn) == CR_SERVER_LOST)) {
+				mutex->unlock();
+				executeStatement(stmts[0]);
+				return 1;
+			}
+			stmts[0]->error = getErrorId();
+			stmts[0]->errorMsg = getError();
+			mutex->unlock();
+			return 1;
+		}
+		// The server stops at the first statement that fails; the statements
+		// after it are sent again.
+		int done = 0;
+		for (;;) {
+			stmts[done]->error = 0;
+			storeResult(stmts[done]);
+			++done;
+			int ret = mysql_next_result(conn);
+			if (ret != 0) {
+				if ((ret > 0) && (done != count)) {
+					stmts[done]->error = getErrorId();
+					stmts[done]->errorMsg = getError();
+					++done;
+				}
+				break;
+			}
+		}
+		mutex->unlock();
+		return done;
+	}
+
+	void MySQL_Connection::executePrepared(SQL_Statement *stmt) {
+		threadId = mysql_thread_id(conn);
+		MYSQL_STMT *handle = prepare(stmt->query);
+		bool isSuccess = (handle != NULL) && (executePrepared(handle, stmt));
+		if ((!isSuccess) && ((lastErrorId == CR_SERVER_GONE_ERROR) || (lastErrorId == CR_SERVER_LOST) || (lastErrorId == ER_UNKNOWN_STMT_HANDLER) || (lastErrorId == ER_NEED_REPREPARE))) {
+			// The statement is prepared again (on a new connection, if it was lost).
+			Logger::log(LOG_DEBUG, "MySQL_Connection::executePrepared: Preparing statement again (conn->id = %d, error = %d)...", id, lastErrorId);
+			forgetPrepared(stmt->query);
+			if (!ping()) {
+				threadId = mysql_thread_id(conn);
+				handle = prepare(stmt->query);
+				isSuccess = (handle != NULL) && (executePrepared(handle, stmt));
+			}
+		}
+		if (isSuccess) {
+			stmt->error = 0;
+		} else {
+			stmt->error = lastErrorId;
+			stmt->errorMsg = lastError;
+		}
+	}
+
+	bool MySQL_Connection::executePrepared(MYSQL_STMT *handle, SQL_Statement *stmt) {
+		int count = mysql_stmt_param_count(handle);
+		std::vector<MYSQL_BIND> params(count);
+		if (count != 0) {
+			memset(&params[0], 0, sizeof(MYSQL_BIND) * count);
+		}
+		for (int i = 0; i != count; ++i) {
+			if (i >= (int) stmt->bindings.size()) {
+				params[i].buffer_type = MYSQL_TYPE_NULL;
+				continue;
+			}
+			SQL_Value &value = stmt->bindings[i];
+			switch (value.type) {
+				case VALUE_TYPE_INT:
+					params[i].buffer_type = MYSQL_TYPE_LONGLONG;
+					params[i].buffer = &value.i;
+					break;
+				case VALUE_TYPE_FLOAT:
+					params[i].buffer_type = MYSQL_TYPE_DOUBLE;
+					params[i].buffer = &value.f;
+					break;
+				case VALUE_TYPE_STRING:
+					params[i].buffer_type = MYSQL_TYPE_STRING;
+					params[i].buffer = value.str;
+					params[i].buffer_length = value.len - 1;
+					break;
+				default:
+					params[i].buffer_type = MYSQL_TYPE_NULL;
+					break;
+			}
+		}
+		if (((count != 0) && (mysql_stmt_bind_param(handle, &params[0]))) || (mysql_stmt_execute(handle))) {
+			setError(handle);
+			return false;
+		}
+		MySQL_ResultSet *r = new MySQL_ResultSet();
+		r->insertId = (int) mysql_stmt_insert_id(handle);
+		r->affectedRows = (int) mysql_stmt_affected_rows(handle);
+		MYSQL_RES *meta = mysql_stmt_result_metadata(handle);
+		if (meta != NULL) {
+			if (mysql_stmt_store_result(handle)) {
+				setError(handle);
+				mysql_free_result(meta);
+				delete r;
+				return false;
+			}
+			r->numFields = mysql_num_fields(meta);
+			r->fieldNames.resize(r->numFields);
+			MYSQL_FIELD *fields = mysql_fetch_fields(meta);
+			// Numbers are fetched in binary form, everything else as text.
+			std::vector<MYSQL_BIND> columns(r->numFields);
+			std::vector<int> types(r->numFields);
+			std::vector<long long> ints(r->numFields);
+			std::vector<double> floats(r->numFields);
+			std::vector<char*> strs(r->numFields, (char*) NULL);
+			std::vector<unsigned long> lengths(r->numFields);
+			std::vector<my_bool> isNull(r->numFields), isTruncated(r->numFields);
+			if (r->numFields != 0) {
+				memset(&columns[0], 0, sizeof(MYSQL_BIND) * r->numFields);
+			}
+			for (int j = 0; j != r->numFields; ++j) {
+				int len = strlen(fields[j].name) + 1;
+				r->fieldNames[j].first = (char*) malloc(sizeof(char) * len);
+				strcpy(r->fieldNames[j].first, fields[j].name);
+				r->fieldNames[j].second = len;
+				switch (fields[j].type) {
+					case MYSQL_TYPE_TINY:
+					case MYSQL_TYPE_SHORT:
+					case MYSQL_TYPE_INT24:
+					case MYSQL_TYPE_LONG:
+					case MYSQL_TYPE_LONGLONG:
+					case MYSQL_TYPE_YEAR:
+						types[j] = VALUE_TYPE_INT;
+						columns[j].buffer_type = MYSQL_TYPE_LONGLONG;
+						columns[j].buffer = &ints[j];
+						columns[j].is_unsigned = (fields[j].flags & UNSIGNED_FLAG) != 0;
+						break;
+					case MYSQL_TYPE_FLOAT:
+					case MYSQL_TYPE_DOUBLE:
+						types[j] = VALUE_TYPE_FLOAT;
+						columns[j].buffer_type = MYSQL_TYPE_DOUBLE;
+						columns[j].buffer = &floats[j];
+						break;
+					default:
+						types[j] = VALUE_TYPE_STRING;
+						strs[j] = (char*) malloc(sizeof(char) * (fields[j].max_length + 1));
+						columns[j].buffer_type = MYSQL_TYPE_STRING;
+						columns[j].buffer = strs[j];
+						columns[j].buffer_length = fields[j].max_length + 1;
+						break;
+				}
+				columns[j].is_null = &isNull[j];
+				columns[j].length = &lengths[j];
+				columns[j].error = &isTruncated[j];
+			}
+			if ((r->numFields != 0) && (!mysql_stmt_bind_result(handle, &columns[0]))) {
+				int ret;
+				while (((ret = mysql_stmt_fetch(handle)) == 0) || (ret == MYSQL_DATA_TRUNCATED)) {
+					r->values.push_back(std::vector<SQL_Value>(r->numFields));
+					std::vector<SQL_Value> &row = r->values.back();
+					for (int j = 0; j != r->numFields; ++j) {
+						if (isNull[j]) {
+							continue;
+						}
+						SQL_Value &value = row[j];
+						value.type = types[j];
+						if (types[j] == VALUE_TYPE_INT) {
+							value.i = ints[j];
+						} else if (types[j] == VALUE_TYPE_FLOAT) {
+							value.f = floats[j];
+						} else {
+							value.len = lengths[j] + 1;
+							value.str = (char*) malloc(sizeof(char) * value.len);
+							if (lengths[j] < columns[j].buffer_length) {
+								memcpy(value.str, strs[j], lengths[j]);
+							} else {
+								// The buffer was too small (e.g. for temporal types).
+								MYSQL_BIND column = columns[j];
+								column.buffer = value.str;
+								column.buffer_length = value.len;
+								mysql_stmt_fetch_column(handle, &column, j, 0);
 							}
+							value.str[lengths[j]] = '\0';
 						}
-					} else {
-						r->lastRow = mysql_fetch_row(r->result);
-						r->lastRowLens = mysql_fetch_lengths(r->result);
 					}
 				}
-				stmt->resultSets.push_back(r);
-			} while (mysql_next_result(conn) == 0);
-		} else {
-			stmt->error = getErrorId();
-			stmt->errorMsg = getError();
+			}
+			r->numRows = r->values.size();
+			for (int j = 0; j != r->numFields; ++j) {
+				free(strs[j]);
+			}
+			mysql_stmt_free_result(handle);
+			mysql_free_result(meta);
+		}
+		stmt->resultSets.push_back(r);
+		return true;
+	}
+
+	MYSQL_STMT *MySQL_Connection::prepare(const char *query) {
+		unsigned long current = mysql_thread_id(conn);
+		if (current != preparedThreadId) {
+			// The connection was reestablished; the statements prepared on the
+			// old one are gone.
+			clearPrepared();
+			preparedThreadId = current;
+		}
+		std::map<std::string, std::list<std::pair<std::string, MYSQL_STMT*> >::iterator>::iterator it = prepared.find(query);
+		if (it != prepared.end()) {
+			++preparedHits;
+			preparedList.splice(preparedList.begin(), preparedList, it->second);
+			return it->second->second;
+		}
+		++preparedMisses;
+		if (prepared.size() >= PREPARED_CACHE_SIZE) {
+			mysql_stmt_close(preparedList.back().second);
+			prepared.erase(preparedList.back().first);
+			preparedList.pop_back();
+			++preparedEvictions;
+		}
+		MYSQL_STMT *handle = mysql_stmt_init(conn);
+		if (handle == NULL) {
+			lastErrorId = mysql_errno(conn);
+			strncpy(lastError, mysql_error(conn), sizeof(lastError) - 1);
+			return NULL;
+		}
+		if (mysql_stmt_prepare(handle, query, strlen(query))) {
+			setError(handle);
+			mysql_stmt_close(handle);
+			return NULL;
 		}
-		stmt->status = STATEMENT_STATUS_EXECUTED;
+		my_bool updateMaxLength = true;
+		mysql_stmt_attr_set(handle, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+		preparedList.push_front(std::make_pair(std::string(query), handle));
+		prepared[query] = preparedList.begin();
+		return handle;
+	}
+
+	void MySQL_Connection::forgetPrepared(const char *query) {
+		std::map<std::string, std::list<std::pair<std::string, MYSQL_STMT*> >::iterator>::iterator it = prepared.find(query);
+		if (it != prepared.end()) {
+			mysql_stmt_close(it->second->second);
+			preparedList.erase(it->second);
+			prepared.erase(it);
+		}
+	}
+
+	void MySQL_Connection::clearPrepared() {
+		for (std::list<std::pair<std::string, MYSQL_STMT*> >::iterator it = preparedList.begin(), end = preparedList.end(); it != end; ++it) {
+			mysql_stmt_close(it->second);
+		}
+		preparedList.clear();
+		prepared.clear();
+	}
+
+	void MySQL_Connection::setError(MYSQL_STMT *handle) {
+		lastErrorId = mysql_stmt_errno(handle);
+		strncpy(lastError, mysql_stmt_error(handle), sizeof(lastError) - 1);
+	}
+
+	bool MySQL_Connection::keepAlive() {
+		mutex->lock();
+		bool ret = !ping();
 		mutex->unlock();
+		// The connection used to interrupt queries idles as long as this one,
+		// so the server would close it too.
+		executingMutex.lock();
+		if ((killer != NULL) && (mysql_ping(killer) != 0)) {
+			Logger::log(LOG_DEBUG, "MySQL_Connection::keepAlive: The connection used to interrupt queries was lost (conn->id = %d, error = %s).", id, mysql_error(killer));
+			mysql_close(killer);
+			killer = NULL;
+		}
+		bool isLost = killer == NULL;
+		executingMutex.unlock();
+		if (isLost) {
+			openKiller();
+		}
+		return ret;
+	}
+
+	MYSQL *MySQL_Connection::connectKiller() {
+		MYSQL *handle = mysql_init(NULL);
+		if (!mysql_real_connect(handle, host, user, pass, NULL, port, NULL, 0)) {
+			Logger::log(LOG_WARNING, "MySQL_Connection::connectKiller: Couldn't connect to the server (conn->id = %d, error = %s).", id, mysql_error(handle));
+			mysql_close(handle);
+			return NULL;
+		}
+		return handle;
+	}
+
+	void MySQL_Connection::openKiller() {
+		MYSQL *handle = connectKiller();
+		if (handle == NULL) {
+			return;
+		}
+		executingMutex.lock();
+		if (killer == NULL) {
+			killer = handle;
+			handle = NULL;
+		}
+		executingMutex.unlock();
+		if (handle != NULL) {
+			mysql_close(handle);
+		}
+	}
+
+	void MySQL_Connection::interrupt() {
+		// `KILL QUERY` has to be sent on another connection because this one
+		// is blocked by the query. It is opened in advance: this is called by
+		// the main thread or the watchdog.
+		if (killer == NULL) {
+			Logger::log(LOG_WARNING, "MySQL_Connection::interrupt: Couldn't interrupt the query, there is no connection to send it on (conn->id = %d).", id);
+			return;
+		}
+		char query[32];
+		snprintf(query, sizeof(query), "KILL QUERY %lu", threadId);
+		if (mysql_query(killer, query)) {
+			int error = mysql_errno(killer);
+			if ((error == CR_SERVER_GONE_ERROR) || (error == CR_SERVER_LOST)) {
+				// The server closed it while it was idle; it is opened again
+				// and the query is sent once more.
+				mysql_close(killer);
+				killer = connectKiller();
+				if ((killer != NULL) && (!mysql_query(killer, query))) {
+					return;
+				}
+			}
+			if (killer != NULL) {
+				Logger::log(LOG_WARNING, "MySQL_Connection::interrupt: Couldn't interrupt the query (conn->id = %d, error = %s).", id, mysql_error(killer));
+				mysql_close(killer);
+				killer = NULL;
+			}
+		}
 	}
 
 	bool MySQL_Connection::seekResult(SQL_Statement *stmt, int resultIdx) {
@@ -150,6 +781,10 @@
 	}
 
 	bool MySQL_Connection::fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
 		if ((0 <= fieldIdx) && (fieldIdx < r->numFields)) {
 			if (dest == NULL) {
@@ -166,6 +801,9 @@
 	}
 
 	bool MySQL_Connection::seekRow(SQL_Statement *stmt, int rowIdx) {
+		if (stmt->resultSets.empty()) {
+			return false;
+		}
 		MySQL_ResultSet *r = static_cast<MySQL_ResultSet*>(stmt->resultSets[stmt->lastResultIdx]);
 		if (rowIdx < 0) {
 			rowIdx = r->lastRowIdx - rowIdx;
@@ -174,7 +812,7 @@
 			return true;
 		}
 		if ((0 <= rowIdx) && (rowIdx < r->numRows)) {
-			if (!(stmt->flags & STATEMENT_FLAGS_CACHED)) {
+			if ((!(stmt->flags & STATEMENT_FLAGS_CACHED)) && (r->result != NULL)) {
 				mysql_data_seek(r->result, rowIdx);
 				r->lastRow = mysql_fetch_row(r->result);
 				r->lastRowLens = mysql_fetch_lengths(r->result);
@@ -186,7 +824,14 @@
 	}
 
 	bool MySQL_Connection::fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		MySQL_ResultSet *r = static_cast<MySQL_ResultSet*>(stmt->resultSets[stmt->lastResultIdx]);
+		if (!r->values.empty()) {
+			return fetchValue(r, fieldIdx, dest, len);
+		}
 		if ((r->numRows != 0) && (0 <= fieldIdx) && (fieldIdx < r->numFields)) {
 			if (stmt->flags & STATEMENT_FLAGS_CACHED) {
 				if (dest == NULL) {
@@ -225,6 +870,10 @@
 	}
 
 	bool MySQL_Connection::fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
 		for (int i = 0, size = r->fieldNames.size(); i != size; ++i) {
 			if (strcmp(r->fieldNames[i].first, fieldName) == 0) {
@@ -29,6 +29,10 @@
  
 #ifdef PLUGIN_SUPPORTS_MYSQL
 
+	#include <list>
+	#include <map>
+	#include <string>
+
 	#include "../SQL_Connection.h"
 
 	class MySQL_Connection : public SQL_Connection {
@@ -48,14 +52,166 @@
 			bool setCharset(char *charset);
 			int escapeString(const char *src, char *&dest);
 			void executeStatement(SQL_Statement *stmt);
+			void rollback();
+			bool canRetry(SQL_Statement *stmt);
+			void executeStatements(std::vector<SQL_Statement*> &stmts);
+			void interrupt();
+			bool keepAlive();
 			bool seekResult(SQL_Statement *stmt, int resultIdx);
 			bool fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
 			bool seekRow(SQL_Statement *stmt, int rowIdx);
 			bool fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
 			bool fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len);
+			char *getCopyCommand(const char *table, const char *columns);
+			char *getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert);
 			
 		private:
 
+			/**
+			 * Stores the current result of the connection (the caller must
+			 * hold `mutex`).
+			 * @param stmt
+			 */
+			void storeResult(SQL_Statement *stmt);
+
+			/**
+			 * Reads the results of the connection row by row and passes them
+			 * to the main thread in chunks (the caller must hold `mutex`).
+			 * @param stmt
+			 */
+			void streamResults(SQL_Statement *stmt);
+
+			/**
+			 * Appends a row to the cache of a result set.
+			 * @param r
+			 * @param row
+			 * @param lengths
+			 */
+			static void cacheRow(SQL_ResultSet *r, MYSQL_ROW row, unsigned long *lengths);
+
+			/**
+			 * Checks if a statement can be sent together with others.
+			 * @param stmt
+			 * @return
+			 */
+			static bool canCoalesce(SQL_Statement *stmt);
+
+			/**
+			 * Starts reading the rows of the bulk load being executed (local
+			 * infile handler). Only bulk loads may read "local files": no file
+			 * is ever read from the disk at the server's request.
+			 * @param ptr
+			 * @param filename
+			 * @param userdata The connection.
+			 * @return
+			 */
+			static int infileInit(void **ptr, const char *filename, void *userdata);
+
+			/**
+			 * Reads the next rows of a bulk load (local infile handler).
+			 * @param ptr
+			 * @param buf
+			 * @param len
+			 * @return The number of bytes read (0 = end of file).
+			 */
+			static int infileRead(void *ptr, char *buf, unsigned int len);
+
+			/**
+			 * Ends reading the rows of a bulk load (local infile handler).
+			 * @param ptr
+			 */
+			static void infileEnd(void *ptr);
+
+			/**
+			 * Gets the error of a local infile handler.
+			 * @param ptr
+			 * @param msg
+			 * @param len
+			 * @return
+			 */
+			static int infileError(void *ptr, char *msg, unsigned int len);
+
+			/**
+			 * Connects to the server with the credentials of this connection.
+			 * @return The new connection or NULL if it failed.
+			 */
+			MYSQL *connectKiller();
+
+			/**
+			 * Opens the connection used to interrupt queries.
+			 */
+			void openKiller();
+
+			/**
+			 * Sends several statements in one multi-statement query and maps
+			 * the results back to them.
+			 * @param stmts
+			 * @param count
+			 * @return The number of statements that were processed (at least 1).
+			 */
+			int executeBatch(SQL_Statement **stmts, int count);
+
+			/**
+			 * Executes a prepared statement (the caller must hold `mutex`).
+			 * @param stmt
+			 */
+			void executePrepared(SQL_Statement *stmt);
+
+			/**
+			 * Binds the parameters, executes a prepared statement and fetches
+			 * its result.
+			 * @param handle
+			 * @param stmt
+			 * @return `false` on error (see `lastErrorId`).
+			 */
+			bool executePrepared(MYSQL_STMT *handle, SQL_Statement *stmt);
+
+			/**
+			 * Gets the prepared statement of a query, preparing it if needed.
+			 * @param query
+			 * @return `NULL` on error (see `lastErrorId`).
+			 */
+			MYSQL_STMT *prepare(const char *query);
+
+			/**
+			 * Closes the prepared statement of a query.
+			 * @param query
+			 */
+			void forgetPrepared(const char *query);
+
+			/**
+			 * Closes all prepared statements.
+			 */
+			void clearPrepared();
+
+			/**
+			 * Saves the last error of a prepared statement.
+			 * @param handle
+			 */
+			void setError(MYSQL_STMT *handle);
+
+			/**
+			 * The statements prepared on this connection (query and handle),
+			 * the most recently used first.
+			 */
+			std::list<std::pair<std::string, MYSQL_STMT*> > preparedList;
+
+			/**
+			 * Maps the queries to their entry in `preparedList`.
+			 */
+			std::map<std::string, std::list<std::pair<std::string, MYSQL_STMT*> >::iterator> prepared;
+
+			/**
+			 * The server thread the statements were prepared on.
+			 */
+			unsigned long preparedThreadId;
+
+			/**
+			 * The last error of a prepared statement.
+			 */
+			int lastErrorId;
+			char lastError[MYSQL_ERRMSG_SIZE];
+
 			/**
 			 * MySQL C connector is not (entirely) thread-safe.
 			 */
@@ -65,6 +221,34 @@
 			 * The MySQL connection resource.
 			 */
 			MYSQL *conn;
+
+			/**
+			 * The ID of the server thread of `conn`.
+			 */
+			volatile unsigned long threadId;
+
+			/**
+			 * The connection used to interrupt queries (opened by `connect`,
+			 * pinged by `keepAlive` and opened again if it is lost). Guarded by
+			 * `executingMutex`.
+			 */
+			MYSQL *killer;
+
+			/**
+			 * The bulk load being executed (read by the local infile handler).
+			 */
+			SQL_Statement *infile;
+
+			/**
+			 * The number of bytes of `infile` that were read.
+			 */
+			int infilePos;
+
+			/**
+			 * The credentials used to open `killer`.
+			 */
+			char *host, *user, *pass;
+			int port;
 	};
 
 #endif
@@ -36,7 +36,19 @@
 	#endif	
 
 	#include <mysql/mysql.h>
+	#include <mysql/errmsg.h>
+	#include <mysql/mysqld_error.h>
 
 	#define MYSQL_DEFAULT_PORT			3306
+
+	#if _MSC_VER
+		#define strncasecmp _strnicmp
+	#endif
+
+	// Keeps batches well below the default `max_allowed_packet`.
+	#define MYSQL_BATCH_MAX_LENGTH		65536
+
+	// The room left in a packet for its header.
+	#define MYSQL_PACKET_HEADROOM		1024
 	
 #endif
@@ -23,6 +23,10 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cctype>
+#include <cstdio>
+#include <string>
+
 #include "../../Logger.h"
 
 #include "PgSQL_Connection.h"
@@ -35,6 +39,9 @@
 	PgSQL_Connection::PgSQL_Connection(int id, AMX *amx) : SQL_Connection(id, amx) {
 		type = PLUGIN_SUPPORTS_PGSQL;
 		conn = NULL;
+		cancel = NULL;
+		lastPreparedId = 0;
+		asyncResult = NULL;
 		if (!PQisthreadsafe()) {
 			Logger::log(LOG_WARNING, "libpq is not thread-safe! Crashes may occur!");
 		}
@@ -53,10 +60,20 @@
 		snprintf(conninfo, len, "user=%s password=%s dbname=%s hostaddr=%s port=%d", user, pass, db, host, port);
 		conn = PQconnectdb(conninfo);
 		free(conninfo);
-		return PQstatus(conn) == CONNECTION_OK;
+		if (PQstatus(conn) != CONNECTION_OK) {
+			return false;
+		}
+		// Created in advance because `PQgetCancel` must not be used while the
+		// connection is busy.
+		cancel = PQgetCancel(conn);
+		return true;
 	}
 
 	void PgSQL_Connection::disconnect() {
+		if (cancel != NULL) {
+			PQfreeCancel(cancel);
+			cancel = NULL;
+		}
 		PQfinish(conn);
 	}
 
@@ -89,44 +106,53 @@
 	}
 
 	void PgSQL_Connection::executeStatement(SQL_Statement *stmt) {
-		if (!ping()) {
+		if (stmt->flags & STATEMENT_FLAGS_STREAMED) {
+			streamResults(stmt);
+			return;
+		}
+		if (stmt->flags & STATEMENT_FLAGS_COPY) {
+			copyRows(stmt);
+			return;
+		}
+		if (stmt->flags & STATEMENT_FLAGS_TRANSACTION) {
+			executeCommands(stmt);
+			return;
+		}
+		// The query is sent right away; the connection is only reestablished
+		// if it turns out to be lost.
+		PGresult *result = send(stmt);
+		if ((PQstatus(conn) == CONNECTION_BAD) && (PQresultStatus(result) == PGRES_FATAL_ERROR)) {
+			Logger::log(LOG_WARNING, "PgSQL_Connection::executeStatement: Connection lost, reconnecting (conn->id = %d)...", id);
+			PQclear(result);
+			result = reset() ? send(stmt) : NULL;
+		}
+		storeResult(stmt, result);
+	}
+
+	void PgSQL_Connection::storeResult(SQL_Statement *stmt, PGresult *result) {
+		if (result != NULL) {
 			PgSQL_ResultSet *r = new PgSQL_ResultSet();
-			r->result = PQexec(conn, stmt->query);
+			r->result = result;
 			switch (PQresultStatus(r->result)) {
 				case PGRES_EMPTY_QUERY: 
 					break;
 				case PGRES_NONFATAL_ERROR:
 				case PGRES_FATAL_ERROR:
-					stmt->error = atoi(PQresStatus(PQresultStatus(r->result)));
+					stmt->error = PQresultStatus(r->result);
 					stmt->errorMsg = PQresultErrorMessage(r->result);
 					break;
 				case PGRES_TUPLES_OK:
 					r->numRows = PQntuples(r->result);
-					r->numFields = PQnfields(r->result);
-					r->fieldNames.resize(r->numFields);
-					for (int i = 0; i != r->numFields; ++i) {
-						int len = strlen(PQfname(r->result, i)) + 1;
-						r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
-						strcpy(r->fieldNames[i].first, PQfname(r->result, i));
-						r->fieldNames[i].second = len;
-					}
+					storeFields(r, r->result);
+					// Binary results that aren't cached are decoded on demand.
 					if (stmt->flags & STATEMENT_FLAGS_CACHED) {
-						r->cache.resize(r->numRows);
+						if (PQbinaryTuples(r->result)) {
+							r->values.reserve(r->numRows);
+						} else {
+							r->cache.reserve(r->numRows);
+						}
 						for (int i = 0; i != r->numRows; ++i) {
-							r->cache[i].resize(r->numFields);
-							for (int j = 0; j != r->numFields; ++j) {
-								char *cell = PQgetvalue(r->result, i, j);
-								int len = strlen(cell);
-								if (len) {
-									r->cache[i][j].first = (char*) malloc(sizeof(char) * (len + 1));
-									strcpy(r->cache[i][j].first, cell);
-									r->cache[i][j].second = len + 1;
-								} else {
-									r->cache[i][j].first = (char*) malloc(sizeof(char) * 5); // NULL + \0
-									strcpy(r->cache[i][j].first, "NULL");
-									r->cache[i][j].second = 5;
-								}
-							}
+							cacheRow(r, r->result, i);
 						}
 					}
 				case PGRES_COMMAND_OK:
@@ -139,7 +165,680 @@
 			stmt->error = getErrorId();
 			stmt->errorMsg = getError();
 		}
-		stmt->status = STATEMENT_STATUS_EXECUTED;
+	}
+
+	void PgSQL_Connection::executeCommands(SQL_Statement *stmt) {
+		// `PQexec` returns only the result of the last command.
+		if ((!sendQuery(stmt)) && ((PQstatus(conn) != CONNECTION_BAD) || (!reset()) || (!sendQuery(stmt)))) {
+			storeResult(stmt, NULL);
+			return;
+		}
+		PGresult *result;
+		while ((result = PQgetResult(conn)) != NULL) {
+			storeResult(stmt, result);
+		}
+	}
+
+	void PgSQL_Connection::rollback() {
+		PQclear(PQexec(conn, "ROLLBACK"));
+	}
+
+	bool PgSQL_Connection::canRetry(SQL_Statement *stmt) {
+		if (stmt->resultSets.empty()) {
+			return false;
+		}
+		const char *state = PQresultErrorField(((PgSQL_ResultSet*) stmt->resultSets.back())->result, PG_DIAG_SQLSTATE);
+		// serialization_failure and deadlock_detected
+		return (state != NULL) && ((strcmp(state, "40001") == 0) || (strcmp(state, "40P01") == 0));
+	}
+
+	void PgSQL_Connection::copyRows(SQL_Statement *stmt) {
+		PGresult *result = PQexec(conn, stmt->query);
+		if ((PQstatus(conn) == CONNECTION_BAD) && (PQresultStatus(result) == PGRES_FATAL_ERROR)) {
+			Logger::log(LOG_WARNING, "PgSQL_Connection::copyRows: Connection lost, reconnecting (conn->id = %d)...", id);
+			PQclear(result);
+			result = reset() ? PQexec(conn, stmt->query) : NULL;
+		}
+		if ((result == NULL) || (PQresultStatus(result) != PGRES_COPY_IN)) {
+			storeResult(stmt, result);
+			return;
+		}
+		PQclear(result);
+		// The whole buffer is sent at once; the connection is blocking, so
+		// libpq writes it in as many packets as needed.
+		if ((PQputCopyData(conn, stmt->data, stmt->dataLen) != 1) || (PQputCopyEnd(conn, NULL) != 1)) {
+			Logger::log(LOG_WARNING, "PgSQL_Connection::copyRows: Couldn't send the rows (conn->id = %d, stmt->id = %d): %s", id, stmt->id, PQerrorMessage(conn));
+		}
+		// The outcome of the copy (the number of rows or the error).
+		bool isStored = false;
+		while ((result = PQgetResult(conn)) != NULL) {
+			storeResult(stmt, result);
+			isStored = true;
+		}
+		if (!isStored) {
+			storeResult(stmt, NULL);
+		}
+	}
+
+	void PgSQL_Connection::streamResults(SQL_Statement *stmt) {
+		if ((!sendQuery(stmt)) && ((PQstatus(conn) != CONNECTION_BAD) || (!reset()) || (!sendQuery(stmt)))) {
+			storeResult(stmt, NULL);
+			return;
+		}
+		PQsetSingleRowMode(conn);
+		// Once discarded, the remaining results are still read (the
+		// connection can't be used otherwise), but they are not kept.
+		bool isDiscarded = false;
+		PgSQL_ResultSet *r = NULL;
+		PGresult *result;
+		while ((result = PQgetResult(conn)) != NULL) {
+			if (isDiscarded) {
+				PQclear(result);
+				continue;
+			}
+			ExecStatusType status = PQresultStatus(result);
+			if ((status != PGRES_SINGLE_TUPLE) && (status != PGRES_TUPLES_OK)) {
+				if ((status == PGRES_COMMAND_OK) && (!stmt->resultSets.empty()) && (!deliverChunk(stmt))) {
+					isDiscarded = true;
+					PQclear(result);
+					continue;
+				}
+				// Commands and errors are stored like any other result.
+				storeResult(stmt, result);
+				r = NULL;
+				continue;
+			}
+			if (r == NULL) {
+				// The last chunk of the previous result isn't the final one.
+				if ((!stmt->resultSets.empty()) && (!deliverChunk(stmt))) {
+					isDiscarded = true;
+					PQclear(result);
+					continue;
+				}
+				r = new PgSQL_ResultSet();
+				storeFields(r, result);
+				stmt->resultSets.push_back(r);
+			}
+			if (status == PGRES_SINGLE_TUPLE) {
+				if (r->numRows == streamChunk) {
+					PgSQL_ResultSet *next = new PgSQL_ResultSet();
+					next->copyFields(r);
+					if (!deliverChunk(stmt)) {
+						delete next;
+						isDiscarded = true;
+						PQclear(result);
+						continue;
+					}
+					r = next;
+					stmt->resultSets.push_back(r);
+				}
+				cacheRow(r, result, 0);
+				++r->numRows;
+			} else {
+				// The end of a result (its rows were already returned one by
+				// one, unless the single row mode couldn't be used).
+				for (int i = 0, count = PQntuples(result); i != count; ++i) {
+					cacheRow(r, result, i);
+					++r->numRows;
+				}
+				r->affectedRows = atoi(PQcmdTuples(result));
+				r = NULL;
+			}
+			PQclear(result);
+		}
+	}
+
+	bool PgSQL_Connection::sendQuery(SQL_Statement *stmt) {
+		if (!stmt->isPrepared) {
+			// The extended protocol rejects queries with several commands, they
+			// are sent in text format.
+			if ((stmt->flags & STATEMENT_FLAGS_BINARY) && (isSingleCommand(stmt->query))) {
+				return PQsendQueryParams(conn, stmt->query, 0, NULL, NULL, NULL, NULL, 1) != 0;
+			}
+			return PQsendQuery(conn, stmt->query) != 0;
+		}
+		// The statement isn't prepared: it would need another round trip.
+		std::vector<const char*> values;
+		std::vector<char> numbers;
+		getParams(stmt, values, numbers);
+		return PQsendQueryParams(conn, stmt->query, values.size(), NULL, values.empty() ? NULL : &values[0], NULL, NULL, getResultFormat(stmt)) != 0;
+	}
+
+	void PgSQL_Connection::storeFields(SQL_ResultSet *r, PGresult *result) {
+		r->numFields = PQnfields(result);
+		r->fieldNames.resize(r->numFields);
+		for (int i = 0; i != r->numFields; ++i) {
+			int len = strlen(PQfname(result, i)) + 1;
+			r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
+			strcpy(r->fieldNames[i].first, PQfname(result, i));
+			r->fieldNames[i].second = len;
+		}
+	}
+
+	void PgSQL_Connection::cacheRow(SQL_ResultSet *r, PGresult *result, int row) {
+		if (PQbinaryTuples(result)) {
+			decodeRow(r, result, row);
+			return;
+		}
+		r->cache.push_back(std::vector<std::pair<char*, int> >(r->numFields));
+		std::vector<std::pair<char*, int> > &cells = r->cache.back();
+		for (int j = 0; j != r->numFields; ++j) {
+			char *cell = PQgetvalue(result, row, j);
+			int len = strlen(cell);
+			if (len) {
+				cells[j].first = (char*) malloc(sizeof(char) * (len + 1));
+				strcpy(cells[j].first, cell);
+				cells[j].second = len + 1;
+			} else {
+				cells[j].first = (char*) malloc(sizeof(char) * 5); // NULL + \0
+				strcpy(cells[j].first, "NULL");
+				cells[j].second = 5;
+			}
+		}
+	}
+
+	void PgSQL_Connection::decodeRow(SQL_ResultSet *r, PGresult *result, int row) {
+		r->values.push_back(std::vector<SQL_Value>(r->numFields));
+		std::vector<SQL_Value> &values = r->values.back();
+		for (int j = 0; j != r->numFields; ++j) {
+			SQL_Value &value = values[j];
+			decodeValue(result, row, j, value);
+			if (value.str != NULL) {
+				char *str = (char*) malloc(sizeof(char) * value.len);
+				memcpy(str, value.str, value.len);
+				value.str = str;
+			}
+		}
+	}
+
+	void PgSQL_Connection::decodeValue(PGresult *result, int row, int field, SQL_Value &value) {
+		value = SQL_Value();
+		if (PQgetisnull(result, row, field)) {
+			return;
+		}
+		char *data = PQgetvalue(result, row, field);
+		switch (PQftype(result, field)) {
+			case PGSQL_BOOLOID:
+				value.type = VALUE_TYPE_INT;
+				value.i = data[0] != 0;
+				break;
+			case PGSQL_INT2OID:
+				value.type = VALUE_TYPE_INT;
+				value.i = (short) readInt(data, 2);
+				break;
+			case PGSQL_INT4OID:
+				value.type = VALUE_TYPE_INT;
+				value.i = (int) readInt(data, 4);
+				break;
+			case PGSQL_OIDOID:
+				value.type = VALUE_TYPE_INT;
+				value.i = (unsigned int) readInt(data, 4);
+				break;
+			case PGSQL_INT8OID:
+				value.type = VALUE_TYPE_INT;
+				value.i = (long long) readInt(data, 8);
+				break;
+			case PGSQL_FLOAT4OID: {
+				unsigned int bits = (unsigned int) readInt(data, 4);
+				float f;
+				memcpy(&f, &bits, sizeof(f));
+				value.type = VALUE_TYPE_FLOAT;
+				value.f = f;
+				break;
+			}
+			case PGSQL_FLOAT8OID: {
+				unsigned long long bits = readInt(data, 8);
+				value.type = VALUE_TYPE_FLOAT;
+				memcpy(&value.f, &bits, sizeof(value.f));
+				break;
+			}
+			case PGSQL_CHAROID:
+			case PGSQL_NAMEOID:
+			case PGSQL_TEXTOID:
+			case PGSQL_JSONOID:
+			case PGSQL_UNKNOWNOID:
+			case PGSQL_BPCHAROID:
+			case PGSQL_VARCHAROID:
+			case PGSQL_JSONBOID:
+				// The binary form of strings is the text itself (libpq adds
+				// the null terminator); `jsonb` starts with a version number.
+				value.type = VALUE_TYPE_STRING;
+				value.str = data;
+				value.len = PQgetlength(result, row, field) + 1;
+				if (PQftype(result, field) == PGSQL_JSONBOID) {
+					++value.str;
+					--value.len;
+				}
+				break;
+			default:
+				if (row == 0) {
+					Logger::log(LOG_WARNING, "PgSQL_Connection::decodeValue: The type of field `%s` (oid = %d) can't be decoded, it has to be cast to text.", PQfname(result, field), (int) PQftype(result, field));
+				}
+				break;
+		}
+	}
+
+	unsigned long long PgSQL_Connection::readInt(const char *data, int len) {
+		unsigned long long ret = 0;
+		for (int i = 0; i != len; ++i) {
+			ret = (ret << 8) | (unsigned char) data[i];
+		}
+		return ret;
+	}
+
+	int PgSQL_Connection::getResultFormat(SQL_Statement *stmt) {
+		return (stmt->flags & STATEMENT_FLAGS_BINARY) ? 1 : 0;
+	}
+
+	PGresult *PgSQL_Connection::send(SQL_Statement *stmt) {
+		if (!stmt->isPrepared) {
+			// Only the extended protocol can return binary results, but it
+			// rejects queries with several commands.
+			if ((stmt->flags & STATEMENT_FLAGS_BINARY) && (isSingleCommand(stmt->query))) {
+				return PQexecParams(conn, stmt->query, 0, NULL, NULL, NULL, NULL, 1);
+			}
+			return PQexec(conn, stmt->query);
+		}
+		// The parameters are sent separately from the query, so they never
+		// have to be escaped.
+		int count = stmt->bindings.size();
+		std::vector<const char*> values;
+		std::vector<char> numbers;
+		getParams(stmt, values, numbers);
+		std::string name;
+		PGresult *result = prepare(stmt->query, name);
+		if (result != NULL) {
+			return result;
+		}
+		result = PQexecPrepared(conn, name.c_str(), count, count != 0 ? &values[0] : NULL, NULL, NULL, getResultFormat(stmt));
+		const char *state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+		if ((state != NULL) && (strcmp(state, PGSQL_UNKNOWN_STATEMENT) == 0)) {
+			// Somebody deallocated it (e.g. `DEALLOCATE ALL` or `DISCARD ALL`).
+			Logger::log(LOG_DEBUG, "PgSQL_Connection::send: Preparing statement again (conn->id = %d)...", id);
+			PQclear(result);
+			forgetPrepared(stmt->query);
+			result = prepare(stmt->query, name);
+			if (result == NULL) {
+				result = PQexecPrepared(conn, name.c_str(), count, count != 0 ? &values[0] : NULL, NULL, NULL, getResultFormat(stmt));
+			}
+		}
+		return result;
+	}
+
+	bool PgSQL_Connection::canExecuteAsync() {
+		return true;
+	}
+
+	bool PgSQL_Connection::canUseCursors() {
+		return true;
+	}
+
+	char *PgSQL_Connection::getCopyCommand(const char *table, const char *columns) {
+		std::string command = "COPY ";
+		command += table;
+		if ((columns != NULL) && (columns[0] != '\0')) {
+			command += " (";
+			command += columns;
+			command += ')';
+		}
+		command += " FROM STDIN";
+		char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+		strcpy(dest, command.c_str());
+		return dest;
+	}
+
+	char *PgSQL_Connection::getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert) {
+		std::string command;
+		char placeholder[16];
+		int size = columns.size();
+		if (isUpsert) {
+			command = "INSERT INTO ";
+			command += table;
+			command += " (";
+			for (int i = 0; i != size; ++i) {
+				command += columns[i];
+				command += ", ";
+			}
+			command += key;
+			command += ") VALUES (";
+			for (int i = 0; i != size + 1; ++i) {
+				snprintf(placeholder, sizeof(placeholder), i == 0 ? "$%d" : ", $%d", i + 1);
+				command += placeholder;
+			}
+			command += ") ON CONFLICT (";
+			command += key;
+			command += ") DO UPDATE SET ";
+			for (int i = 0; i != size; ++i) {
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += " = EXCLUDED.";
+				command += columns[i];
+			}
+		} else {
+			command = "UPDATE ";
+			command += table;
+			command += " SET ";
+			for (int i = 0; i != size; ++i) {
+				snprintf(placeholder, sizeof(placeholder), " = $%d", i + 1);
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += placeholder;
+			}
+			snprintf(placeholder, sizeof(placeholder), " = $%d", size + 1);
+			command += " WHERE ";
+			command += key;
+			command += placeholder;
+		}
+		char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+		strcpy(dest, command.c_str());
+		return dest;
+	}
+
+	int PgSQL_Connection::getSocket() {
+		return PQsocket(conn);
+	}
+
+	bool PgSQL_Connection::sendStatement(SQL_Statement *stmt) {
+		if ((PQstatus(conn) == CONNECTION_BAD) && (!reset())) {
+			storeResult(stmt, NULL);
+			return false;
+		}
+		// Switched back once the statement is done, so the executor can use
+		// the connection too.
+		PQsetnonblocking(conn, 1);
+		if (!sendQuery(stmt)) {
+			PQsetnonblocking(conn, 0);
+			storeResult(stmt, NULL);
+			return false;
+		}
+		return true;
+	}
+
+	int PgSQL_Connection::pollStatement(SQL_Statement *stmt) {
+		int ret = PQflush(conn);
+		if (ret == 1) {
+			return ASYNC_WRITING;
+		}
+		if ((ret == -1) || (!PQconsumeInput(conn))) {
+			if (asyncResult != NULL) {
+				PQclear(asyncResult);
+				asyncResult = NULL;
+			}
+			PQsetnonblocking(conn, 0);
+			storeResult(stmt, NULL);
+			return ASYNC_DONE;
+		}
+		while (!PQisBusy(conn)) {
+			PGresult *result = PQgetResult(conn);
+			if (result == NULL) {
+				// Like `PQexec`, only the last result is kept.
+				PQsetnonblocking(conn, 0);
+				storeResult(stmt, asyncResult);
+				asyncResult = NULL;
+				return ASYNC_DONE;
+			}
+			if (asyncResult != NULL) {
+				PQclear(asyncResult);
+			}
+			asyncResult = result;
+		}
+		return ASYNC_READING;
+	}
+
+	void PgSQL_Connection::getParams(SQL_Statement *stmt, std::vector<const char*> &values, std::vector<char> &numbers) {
+		int count = stmt->bindings.size();
+		values.assign(count, (const char*) NULL);
+		numbers.resize(count * 32);
+		for (int i = 0; i != count; ++i) {
+			SQL_Value &value = stmt->bindings[i];
+			switch (value.type) {
+				case VALUE_TYPE_INT:
+					snprintf(&numbers[i * 32], 32, "%lld", value.i);
+					values[i] = &numbers[i * 32];
+					break;
+				case VALUE_TYPE_FLOAT:
+					snprintf(&numbers[i * 32], 32, "%.17g", value.f);
+					values[i] = &numbers[i * 32];
+					break;
+				case VALUE_TYPE_STRING:
+					values[i] = value.str;
+					break;
+			}
+		}
+	}
+
+	void PgSQL_Connection::executeStatements(std::vector<SQL_Statement*> &stmts) {
+		#ifdef LIBPQ_HAS_PIPELINING
+			// Statements with several commands, streamed statements and copies
+			// can't be pipelined; they split the batch in several pipelines.
+			std::vector<SQL_Statement*> pipeline;
+			for (int i = 0, size = stmts.size(); i != size; ++i) {
+				if ((!(stmts[i]->flags & (STATEMENT_FLAGS_STREAMED | STATEMENT_FLAGS_COPY))) && ((stmts[i]->isPrepared) || (isSingleCommand(stmts[i]->query)))) {
+					pipeline.push_back(stmts[i]);
+					continue;
+				}
+				executePipeline(pipeline);
+				pipeline.clear();
+				executeStatement(stmts[i]);
+			}
+			executePipeline(pipeline);
+		#else
+			SQL_Connection::executeStatements(stmts);
+		#endif
+	}
+
+	#ifdef LIBPQ_HAS_PIPELINING
+
+		void PgSQL_Connection::executePipeline(std::vector<SQL_Statement*> &stmts) {
+			int size = stmts.size();
+			if ((size < 2) || (PQstatus(conn) != CONNECTION_OK)) {
+				SQL_Connection::executeStatements(stmts);
+				return;
+			}
+			// Statements can't be prepared in pipeline mode, so it's done in
+			// advance.
+			std::vector<std::string> names(size);
+			std::vector<bool> isSent(size, false);
+			for (int i = 0; i != size; ++i) {
+				if (stmts[i]->isPrepared) {
+					PGresult *result = prepare(stmts[i]->query, names[i]);
+					if (result != NULL) {
+						storeResult(stmts[i], result);
+						names[i].clear();
+					}
+				}
+			}
+			if (!PQenterPipelineMode(conn)) {
+				SQL_Connection::executeStatements(stmts);
+				return;
+			}
+			Logger::log(LOG_DEBUG, "PgSQL_Connection::executePipeline: Sending %d statements (conn->id = %d)...", size, id);
+			for (int i = 0; i != size; ++i) {
+				SQL_Statement *stmt = stmts[i];
+				int ret;
+				if (stmt->isPrepared) {
+					if (names[i].empty()) {
+						continue;
+					}
+					std::vector<const char*> values;
+					std::vector<char> numbers;
+					getParams(stmt, values, numbers);
+					ret = PQsendQueryPrepared(conn, names[i].c_str(), values.size(), values.empty() ? NULL : &values[0], NULL, NULL, getResultFormat(stmt));
+				} else {
+					ret = PQsendQueryParams(conn, stmt->query, 0, NULL, NULL, NULL, NULL, getResultFormat(stmt));
+				}
+				// Each statement is followed by a synchronization point, so an
+				// error doesn't abort the statements after it.
+				if ((!ret) || (!PQpipelineSync(conn))) {
+					break;
+				}
+				isSent[i] = true;
+			}
+			for (int i = 0; i != size; ++i) {
+				SQL_Statement *stmt = stmts[i];
+				if (!isSent[i]) {
+					if ((!stmt->isPrepared) || (!names[i].empty())) {
+						storeResult(stmt, NULL);
+					}
+					continue;
+				}
+				PGresult *result = NULL, *next;
+				while ((next = PQgetResult(conn)) != NULL) {
+					if (result != NULL) {
+						PQclear(result);
+					}
+					result = next;
+				}
+				storeResult(stmt, result);
+				// The result of the synchronization point.
+				next = PQgetResult(conn);
+				if (next != NULL) {
+					PQclear(next);
+				}
+			}
+			PQexitPipelineMode(conn);
+			if (PQstatus(conn) == CONNECTION_BAD) {
+				Logger::log(LOG_WARNING, "PgSQL_Connection::executePipeline: Connection lost, reconnecting (conn->id = %d)...", id);
+				reset();
+			}
+		}
+
+	#endif
+
+	PGresult *PgSQL_Connection::prepare(const char *query, std::string &name) {
+		std::string key = normalize(query);
+		std::map<std::string, std::list<std::pair<std::string, std::string> >::iterator>::iterator it = prepared.find(key);
+		if (it != prepared.end()) {
+			++preparedHits;
+			preparedList.splice(preparedList.begin(), preparedList, it->second);
+			name = it->second->second;
+			return NULL;
+		}
+		++preparedMisses;
+		if (prepared.size() >= PREPARED_CACHE_SIZE) {
+			std::string dealloc = "DEALLOCATE " + preparedList.back().second;
+			PQclear(PQexec(conn, dealloc.c_str()));
+			prepared.erase(preparedList.back().first);
+			preparedList.pop_back();
+			++preparedEvictions;
+		}
+		char tmp[32];
+		snprintf(tmp, sizeof(tmp), PGSQL_STATEMENT_NAME, ++lastPreparedId);
+		name = tmp;
+		// The normalized query is only a key (it doesn't know block
+		// comments), so the server gets the original.
+		PGresult *result = PQprepare(conn, tmp, query, 0, NULL);
+		if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+			return result;
+		}
+		PQclear(result);
+		preparedList.push_front(std::make_pair(key, name));
+		prepared[key] = preparedList.begin();
+		return NULL;
+	}
+
+	void PgSQL_Connection::forgetPrepared(const char *query) {
+		std::map<std::string, std::list<std::pair<std::string, std::string> >::iterator>::iterator it = prepared.find(normalize(query));
+		if (it != prepared.end()) {
+			preparedList.erase(it->second);
+			prepared.erase(it);
+		}
+	}
+
+	std::string PgSQL_Connection::normalize(const char *query) {
+		std::string ret, tag;
+		char quote = 0;
+		bool isEscaped = false, isSpace = false;
+		for (const char *c = query; *c != '\0'; ++c) {
+			if (!tag.empty()) {
+				// The body of a dollar quote is kept as it is.
+				if (strncmp(c, tag.c_str(), tag.length()) == 0) {
+					ret += tag;
+					c += tag.length() - 1;
+					tag.clear();
+				} else {
+					ret += *c;
+				}
+				continue;
+			}
+			bool isWord = (c != query) && ((isalnum((unsigned char) c[-1])) || (c[-1] == '_') || (c[-1] == '$'));
+			if (quote != 0) {
+				if ((isEscaped) && (*c == '\\') && (c[1] != '\0')) {
+					// An escaped quote doesn't end an `E''` string.
+					ret += *c++;
+				} else if (*c == quote) {
+					quote = 0;
+				}
+			} else if (isspace((unsigned char) *c)) {
+				isSpace = true;
+				continue;
+			} else if ((*c == '\'') || (*c == '"')) {
+				quote = *c;
+				isEscaped = (*c == '\'') && (isWord) && ((c[-1] == 'E') || (c[-1] == 'e')) && ((c - 1 == query) || (!isalnum((unsigned char) c[-2])));
+			} else if ((*c == '-') && (c[1] == '-')) {
+				quote = '\n'; // Comments end with the line.
+				isEscaped = false;
+			} else if ((*c == '$') && (!isWord) && (!isdigit((unsigned char) c[1]))) {
+				// `$tag$` starts a dollar quote (`$1` is a parameter).
+				const char *end = c + 1;
+				while ((isalnum((unsigned char) *end)) || (*end == '_')) {
+					++end;
+				}
+				if (*end == '$') {
+					tag.assign(c, end - c + 1);
+				}
+			}
+			if ((isSpace) && (!ret.empty())) {
+				ret += ' ';
+			}
+			isSpace = false;
+			if (!tag.empty()) {
+				ret += tag;
+				c += tag.length() - 1;
+				continue;
+			}
+			ret += *c;
+		}
+		return ret;
+	}
+
+	bool PgSQL_Connection::reset() {
+		PQreset(conn);
+		// The prepared statements were lost with the old session.
+		preparedList.clear();
+		prepared.clear();
+		if (PQstatus(conn) != CONNECTION_OK) {
+			return false;
+		}
+		// The cancel object is bound to the server process, which changed.
+		executingMutex.lock();
+		if (cancel != NULL) {
+			PQfreeCancel(cancel);
+		}
+		cancel = PQgetCancel(conn);
+		executingMutex.unlock();
+		return true;
+	}
+
+	bool PgSQL_Connection::keepAlive() {
+		PGresult *result = PQexec(conn, "");
+		bool ret = PQresultStatus(result) == PGRES_EMPTY_QUERY;
+		PQclear(result);
+		return ret ? true : reset();
+	}
+
+	void PgSQL_Connection::interrupt() {
+		if (cancel == NULL) {
+			return;
+		}
+		char error[256];
+		if (!PQcancel(cancel, error, sizeof(error))) {
+			Logger::log(LOG_WARNING, "PgSQL_Connection::interrupt: Couldn't interrupt the query (conn->id = %d, error = %s).", id, error);
+		}
 	}
 
 	bool PgSQL_Connection::seekResult(SQL_Statement *stmt, int resultIdx) {
@@ -157,6 +856,10 @@
 	}
 
 	bool PgSQL_Connection::fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
 		if ((0 <= fieldIdx) && (fieldIdx < r->numFields)) {
 			if (dest == NULL) {
@@ -173,6 +876,9 @@
 	}
 
 	bool PgSQL_Connection::seekRow(SQL_Statement *stmt, int rowIdx) {
+		if (stmt->resultSets.empty()) {
+			return false;
+		}
 		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
 		if (rowIdx < 0) {
 			rowIdx = r->lastRowIdx - rowIdx;
@@ -188,7 +894,15 @@
 	}
 
 	bool PgSQL_Connection::fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		PgSQL_ResultSet *r = static_cast<PgSQL_ResultSet*>(stmt->resultSets[stmt->lastResultIdx]);
+		SQL_Value value;
+		if (getValue(stmt, fieldIdx, value)) {
+			return formatValue(value, dest, len);
+		}
 		if ((r->numRows != 0) && (0 <= fieldIdx) && (fieldIdx < r->numFields)) {
 			if (stmt->flags & STATEMENT_FLAGS_CACHED) {
 				if (dest == NULL) {
@@ -200,14 +914,16 @@
 					return true;
 				}
 			} else {
-				int _len = strlen(PQgetvalue(r->result, r->lastRowIdx, fieldIdx));
+				// The length is known, there's no need to look for the end.
+				int _len = PQgetlength(r->result, r->lastRowIdx, fieldIdx);
 				if (_len) {
+					char *value = PQgetvalue(r->result, r->lastRowIdx, fieldIdx);
 					if (dest == NULL) {
 						len = _len + 1;
 						dest = (char*) malloc(sizeof(char) * len);
-						memcpy(dest, PQgetvalue(r->result, r->lastRowIdx, fieldIdx), len);
+						memcpy(dest, value, len);
 					} else {
-						memcpy(dest, PQgetvalue(r->result, r->lastRowIdx, fieldIdx), len);
+						memcpy(dest, value, len);
 					}
 				} else {
 					if (dest == NULL) {
@@ -226,6 +942,10 @@
 	}
 
 	bool PgSQL_Connection::fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
 		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
 		for (int i = 0, size = r->fieldNames.size(); i != size; ++i) {
 			if (strcmp(r->fieldNames[i].first, fieldName) == 0) {
@@ -236,4 +956,19 @@
 		return true;
 	}
 
+	bool PgSQL_Connection::getValue(SQL_Statement *stmt, int fieldIdx, SQL_Value &value) {
+		if (stmt->resultSets.empty()) {
+			return false;
+		}
+		if (SQL_Connection::getValue(stmt, fieldIdx, value)) {
+			return true;
+		}
+		PgSQL_ResultSet *r = static_cast<PgSQL_ResultSet*>(stmt->resultSets[stmt->lastResultIdx]);
+		if ((r->result == NULL) || (!PQbinaryTuples(r->result)) || (r->numRows == 0) || (fieldIdx < 0) || (fieldIdx >= r->numFields)) {
+			return false;
+		}
+		decodeValue(r->result, r->lastRowIdx, fieldIdx, value);
+		return true;
+	}
+
 #endif
@@ -29,6 +29,10 @@
  
 #ifdef PLUGIN_SUPPORTS_PGSQL
 
+	#include <list>
+	#include <map>
+	#include <string>
+
 	#include "../SQL_Connection.h"
 
 	class PgSQL_Connection : public SQL_Connection {
@@ -48,18 +52,195 @@
 			bool setCharset(char *charset);
 			int escapeString(const char *src, char *&dest);
 			void executeStatement(SQL_Statement *stmt);
+			void executeStatements(std::vector<SQL_Statement*> &stmts);
+			void rollback();
+			bool canRetry(SQL_Statement *stmt);
+			bool canExecuteAsync();
+			bool canUseCursors();
+			char *getCopyCommand(const char *table, const char *columns);
+			char *getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert);
+			int getSocket();
+			bool sendStatement(SQL_Statement *stmt);
+			int pollStatement(SQL_Statement *stmt);
+			void interrupt();
+			bool keepAlive();
 			bool seekResult(SQL_Statement *stmt, int resultIdx);
 			bool fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
 			bool seekRow(SQL_Statement *stmt, int rowIdx);
 			bool fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
+			bool getValue(SQL_Statement *stmt, int fieldIdx, SQL_Value &value);
 			bool fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len);	private:
 			
 		private:
 		
+			/**
+			 * Sends a statement (with its parameters, if it is prepared).
+			 * @param stmt
+			 * @return
+			 */
+			PGresult *send(SQL_Statement *stmt);
+		
+			/**
+			 * Stores the result of a statement (or the error of the connection,
+			 * if there is no result).
+			 * @param stmt
+			 * @param result
+			 */
+			void storeResult(SQL_Statement *stmt, PGresult *result);
+		
+			/**
+			 * Executes a statement, reading its results row by row and passing
+			 * them to the main thread in chunks.
+			 * @param stmt
+			 */
+			void streamResults(SQL_Statement *stmt);
+		
+			/**
+			 * Executes a statement made of several commands, keeping the
+			 * results of all of them.
+			 * @param stmt
+			 */
+			void executeCommands(SQL_Statement *stmt);
+		
+			/**
+			 * Executes a `COPY ... FROM STDIN` statement, sending its rows.
+			 * @param stmt
+			 */
+			void copyRows(SQL_Statement *stmt);
+		
+			/**
+			 * Sends a statement without waiting for its result.
+			 * @param stmt
+			 * @return `true` if succesful.
+			 */
+			bool sendQuery(SQL_Statement *stmt);
+		
+			/**
+			 * Copies the names of the fields of a result.
+			 * @param r
+			 * @param result
+			 */
+			static void storeFields(SQL_ResultSet *r, PGresult *result);
+		
+			/**
+			 * Appends a row of a result to the cache of a result set.
+			 * @param r
+			 * @param result
+			 * @param row
+			 */
+			static void cacheRow(SQL_ResultSet *r, PGresult *result, int row);
+		
+			/**
+			 * Decodes a row of a binary result into typed values.
+			 * @param r
+			 * @param result
+			 * @param row
+			 */
+			static void decodeRow(SQL_ResultSet *r, PGresult *result, int row);
+		
+			/**
+			 * Decodes a field of a binary result (without copying strings).
+			 * @param result
+			 * @param row
+			 * @param field
+			 * @param value
+			 */
+			static void decodeValue(PGresult *result, int row, int field, SQL_Value &value);
+		
+			/**
+			 * Reads an integer in network byte order.
+			 * @param data
+			 * @param len
+			 * @return
+			 */
+			static unsigned long long readInt(const char *data, int len);
+		
+			/**
+			 * Gets the format the results of a statement are requested in.
+			 * @param stmt
+			 * @return 1 for binary, 0 for text.
+			 */
+			static int getResultFormat(SQL_Statement *stmt);
+		
+			/**
+			 * Converts the parameters of a statement to text.
+			 * @param stmt
+			 * @param values The parameters (NULL for null values).
+			 * @param numbers Storage for the converted numbers.
+			 */
+			static void getParams(SQL_Statement *stmt, std::vector<const char*> &values, std::vector<char> &numbers);
+		
+		#ifdef LIBPQ_HAS_PIPELINING
+		
+			/**
+			 * Sends several statements back to back (in pipeline mode) and
+			 * reads their results afterwards, in order.
+			 * @param stmts
+			 */
+			void executePipeline(std::vector<SQL_Statement*> &stmts);
+		
+		#endif
+		
+			/**
+			 * Gets the name of the prepared statement of a query, preparing it
+			 * if needed. The most recently used statements are kept.
+			 * @param query
+			 * @param name
+			 * @return NULL if succesful, the result of the failed preparation otherwise.
+			 */
+			PGresult *prepare(const char *query, std::string &name);
+		
+			/**
+			 * Deallocates the prepared statement of a query.
+			 * @param query
+			 */
+			void forgetPrepared(const char *query);
+		
+			/**
+			 * Normalizes the whitespace of a query (outside literals, dollar
+			 * quotes and comments), so queries that differ only in formatting
+			 * share a statement. The result is only used as a cache key.
+			 * @param query
+			 * @return
+			 */
+			static std::string normalize(const char *query);
+		
+			/**
+			 * Reestablishes the connection.
+			 * @return `true` if succesful.
+			 */
+			bool reset();
+		
+			/**
+			 * The statements prepared on this connection (normalized query and
+			 * statement name), the most recently used first.
+			 */
+			std::list<std::pair<std::string, std::string> > preparedList;
+		
+			/**
+			 * Maps the normalized queries to their entry in `preparedList`.
+			 */
+			std::map<std::string, std::list<std::pair<std::string, std::string> >::iterator> prepared;
+		
+			/**
+			 * The ID of the last statement prepared on this connection.
+			 */
+			int lastPreparedId;
+		
+			/**
+			 * The last result received for the statement sent asynchronously.
+			 */
+			PGresult *asyncResult;
+		
 			/**
 			 * The PostgreSQL connection resource.
 			 */
 			PGconn *conn;
+
+			/**
+			 * Used to interrupt the query being executed.
+			 */
+			PGcancel *cancel;
 	};
 
 #endif
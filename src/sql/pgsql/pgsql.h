@@ -33,6 +33,28 @@
 
 	#define PGSQL_DEFAULT_PORT			5432
 
+	#define PGSQL_STATEMENT_NAME		"sql_stmt_%d"
+
+	// SQLSTATE of `invalid_sql_statement_name`.
+	#define PGSQL_UNKNOWN_STATEMENT		"26000"
+
+	// The OIDs of the types decoded from binary results (`pg_type.h`).
+	#define PGSQL_BOOLOID				16
+	#define PGSQL_CHAROID				18
+	#define PGSQL_NAMEOID				19
+	#define PGSQL_INT8OID				20
+	#define PGSQL_INT2OID				21
+	#define PGSQL_INT4OID				23
+	#define PGSQL_TEXTOID				25
+	#define PGSQL_OIDOID				26
+	#define PGSQL_JSONOID				114
+	#define PGSQL_FLOAT4OID				700
+	#define PGSQL_FLOAT8OID				701
+	#define PGSQL_UNKNOWNOID			705
+	#define PGSQL_BPCHAROID				1042
+	#define PGSQL_VARCHAROID			1043
+	#define PGSQL_JSONBOID				3802
+
 	#if _MSC_VER
 		#define snprintf _snprintf
 	#endif
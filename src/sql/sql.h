@@ -28,7 +28,7 @@
 #include <vector>
 
 #include <boost/unordered_map.hpp>
-#include <boost/lockfree/queue.hpp>
+#include <boost/atomic.hpp>
 
 #include "../sdk/amx/amx.h"
 #include "../sdk/amx/amx2.h"
@@ -38,18 +38,130 @@
 #define STATEMENT_FLAGS_NONE			0
 #define STATEMENT_FLAGS_THREADED		1
 #define STATEMENT_FLAGS_CACHED			2
+#define STATEMENT_FLAGS_PRIORITY_HIGH	4
+#define STATEMENT_FLAGS_PRIORITY_LOW	8
+#define STATEMENT_FLAGS_STREAMED		16
+#define STATEMENT_FLAGS_BINARY			32
+#define STATEMENT_FLAGS_CLOSES_CURSOR	256
+#define STATEMENT_FLAGS_COPY			512
+#define STATEMENT_FLAGS_INSERT			1024
+#define STATEMENT_FLAGS_TRANSACTION		2048
+#define STATEMENT_FLAGS_UNDROPPABLE		4096
+
+#define STATEMENT_PRIORITY_HIGH			0
+#define STATEMENT_PRIORITY_NORMAL		1
+#define STATEMENT_PRIORITY_LOW			2
+#define STATEMENT_PRIORITY_COUNT		3
+
+#define STATEMENT_PRIORITY_HIGH_WEIGHT	8
+#define STATEMENT_PRIORITY_NORMAL_WEIGHT	4
+#define STATEMENT_PRIORITY_LOW_WEIGHT	1
 
 #define STATEMENT_STATUS_NONE			0
-#define STATEMENT_STATUS_EXECUTED		1
-#define STATEMENT_STATUS_PROCESSED		2
+#define STATEMENT_STATUS_QUEUED			1
+#define STATEMENT_STATUS_EXECUTING		2
+#define STATEMENT_STATUS_EXECUTED		3
+#define STATEMENT_STATUS_PROCESSED		4
+
+#define CHUNK_STATE_NONE				0
+#define CHUNK_STATE_READY				1
+#define CHUNK_STATE_DELIVERING			2
+
+#define STATEMENT_ERROR_TIMEOUT			-1
+#define STATEMENT_ERROR_CANCELLED		-2
+#define STATEMENT_ERROR_QUEUE_FULL		-3
+#define STATEMENT_ERROR_BUSY			-4
+
+#define QUEUE_POLICY_REJECT				0
+#define QUEUE_POLICY_DROP_OLDEST		1
+#define QUEUE_POLICY_BLOCK				2
+
+#define QUEUE_BLOCK_TIMEOUT				1000
+
+#define WORKER_SPIN_MIN					16
+#define WORKER_SPIN_MAX					1024
+
+#define EXECUTOR_DEFAULT_THREADS		4
+#define EXECUTOR_QUOTA					32
+
+#define VALUE_TYPE_NULL					0
+#define VALUE_TYPE_INT					1
+#define VALUE_TYPE_FLOAT				2
+#define VALUE_TYPE_STRING				3
+
+#define PREPARED_MAX_PARAMS				256
+#define PREPARED_CACHE_SIZE				64
+
+// A batch may not have more statements than the prepared statements cache.
+#define BATCH_MAX_SIZE					64
+#define BATCH_MAX_DELAY					1000
+
+#define CURSOR_NAME						"sql_cursor_%d"
+
+#define COPY_INFILE_NAME				"sql_bulk"
+#define COPY_DEFAULT_SIZE				65536
+#define COPY_DEFAULT_AGE				1000
+
+#define INSERT_DEFAULT_ROWS				1000
+#define INSERT_MAX_LENGTH				1048576
+
+#define STORE_DEFAULT_INTERVAL			1000
 
-#define WORKER_TICK_RATE				50
+#define TRANSACTION_MAX_ATTEMPTS		3
+#define TRANSACTION_RETRY_DELAY			10
+
+#define STREAM_DEFAULT_CHUNK			1000
+#define STREAM_WAIT_INTERVAL			100
+
+#define REACTOR_MAX_EVENTS				64
+
+#define ASYNC_READING					0
+#define ASYNC_WRITING					1
+#define ASYNC_DONE						2
+
+#define WATCHDOG_RESOLUTION				10
+#define WATCHDOG_SLOTS					256
+
+#define KEEPALIVE_DEFAULT_IDLE			60000
+#define KEEPALIVE_CHECK_INTERVAL		1000
+
+#define DRAIN_DEFAULT_TIMEOUT			5000
+#define DRAIN_INTERRUPT_TIMEOUT			1000
+
+#define CONNECTION_STATE_IDLE			0
+#define CONNECTION_STATE_SCHEDULED		1
+#define CONNECTION_STATE_RUNNING		2
+#define CONNECTION_STATE_DIRTY			3
 
 // SQL_Connection
 class SQL_Connection;
 typedef boost::unordered_map<int, class SQL_Connection*> connectionsMap_t;
 
+// SQL_Executor
+struct SQL_ExecutorThread;
+
 // SQL_Statement
 class SQL_Statement;
 typedef boost::unordered_map<int, class SQL_Statement*> statementsMap_t;
-typedef boost::lockfree::queue<class SQL_Statement*> statementsQueue_t;
+
+// SQL_ResultSet
+class SQL_ResultSet;
+
+// SQL_Value
+struct SQL_Value;
+
+// SQL_Prepared
+class SQL_Prepared;
+typedef boost::unordered_map<int, class SQL_Prepared*> preparedMap_t;
+
+// SQL_Cursor
+class SQL_Cursor;
+typedef boost::unordered_map<int, class SQL_Cursor*> cursorsMap_t;
+
+// SQL_Copy
+class SQL_Copy;
+typedef boost::unordered_map<int, class SQL_Copy*> copiesMap_t;
+
+// SQL_Store
+class SQL_Store;
+typedef boost::unordered_map<int, class SQL_Store*> storesMap_t;
@@ -0,0 +1,456 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../../Logger.h"
+
+#include "SQLite_Connection.h"
+ 
+#ifdef PLUGIN_SUPPORTS_SQLITE
+
+	#include "SQLite_ResultSet.h"
+	#include "SQLite_Statement.h"
+
+	SQLite_Connection::SQLite_Connection(int id, AMX *amx) : SQL_Connection(id, amx) {
+		type = PLUGIN_SUPPORTS_SQLITE;
+		mutex = new Mutex();
+		conn = NULL;
+		stat[0] = '\0';
+		if (!sqlite3_threadsafe()) {
+			Logger::log(LOG_WARNING, "SQLite is not thread-safe! Crashes may occur!");
+		}
+	}
+
+	SQLite_Connection::~SQLite_Connection() {
+		disconnect();
+		delete mutex;
+	}
+
+	bool SQLite_Connection::connect(const char *host, const char *user, const char *pass, const char *db, int port) {
+		// There is no server: the database is a local file.
+		if (db == NULL) {
+			return false;
+		}
+		// The connection is guarded by `mutex`, SQLite doesn't have to lock it again.
+		if (sqlite3_open_v2(db, &conn, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+			return false;
+		}
+		// The members of a pool (and other processes) share the file.
+		sqlite3_busy_timeout(conn, SQLITE_LOCK_WAIT);
+		// Readers don't block the writer (and the other way around) and the
+		// file is synced only at checkpoints.
+		sqlite3_exec(conn, "PRAGMA journal_mode = WAL", NULL, NULL, NULL);
+		sqlite3_exec(conn, "PRAGMA synchronous = NORMAL", NULL, NULL, NULL);
+		int maxLength = sqlite3_limit(conn, SQLITE_LIMIT_SQL_LENGTH, -1);
+		if (maxLength < maxQueryLength) {
+			maxQueryLength = maxLength;
+		}
+		return true;
+	}
+
+	void SQLite_Connection::disconnect() {
+		clearPrepared();
+		sqlite3_close(conn);
+		conn = NULL;
+	}
+
+	int SQLite_Connection::getErrorId() {
+		return sqlite3_extended_errcode(conn);
+	}
+
+	const char *SQLite_Connection::getError() {
+		return sqlite3_errmsg(conn);
+	}
+
+	int SQLite_Connection::ping() {
+		return conn != NULL ? SQLITE_OK : SQLITE_MISUSE;
+	}
+
+	const char *SQLite_Connection::getStat() {
+		snprintf(stat, sizeof(stat), "SQLite %s  Memory used: %lld  Prepared statements: %d", sqlite3_libversion(), (long long) sqlite3_memory_used(), (int) prepared.size());
+		return stat;
+	}
+
+	const char *SQLite_Connection::getCharset() {
+		return "UTF-8";
+	}
+
+	bool SQLite_Connection::setCharset(char *charset) {
+		// The encoding of a database can't be changed once it was created.
+		return false;
+	}
+
+	int SQLite_Connection::escapeString(const char *src, char *&dest) {
+		int len = 0;
+		for (const char *c = src; *c != '\0'; ++c) {
+			if (*c == '\'') {
+				dest[len++] = '\'';
+			}
+			dest[len++] = *c;
+		}
+		dest[len] = '\0';
+		return len;
+	}
+
+	void SQLite_Connection::executeStatement(SQL_Statement *stmt) {
+		mutex->lock();
+		stmt->error = 0;
+		if ((stmt->isPrepared) && (isSingleCommand(stmt->query))) {
+			sqlite3_stmt *handle = prepare(stmt->query);
+			if (handle != NULL) {
+				executeCommand(stmt, handle);
+			} else if (sqlite3_errcode(conn) != SQLITE_OK) {
+				stmt->error = getErrorId();
+				stmt->errorMsg = getError();
+				stmt->copyError();
+			}
+			mutex->unlock();
+			return;
+		}
+		// The other queries are prepared (and finalized) one command at a time.
+		const char *query = stmt->query;
+		while (*query != '\0') {
+			sqlite3_stmt *handle = NULL;
+			if (sqlite3_prepare_v2(conn, query, -1, &handle, &query) != SQLITE_OK) {
+				stmt->error = getErrorId();
+				stmt->errorMsg = getError();
+				stmt->copyError();
+				break;
+			}
+			if (handle == NULL) {
+				// Only whitespace or comments were left.
+				continue;
+			}
+			bool isSuccess = executeCommand(stmt, handle);
+			sqlite3_finalize(handle);
+			if (!isSuccess) {
+				break;
+			}
+		}
+		mutex->unlock();
+	}
+
+	bool SQLite_Connection::executeCommand(SQL_Statement *stmt, sqlite3_stmt *handle) {
+		if ((stmt->isPrepared) && (!bindParams(stmt, handle))) {
+			stmt->error = getErrorId();
+			stmt->errorMsg = getError();
+			stmt->copyError();
+			sqlite3_clear_bindings(handle);
+			return false;
+		}
+		bool isStreamed = (stmt->flags & STATEMENT_FLAGS_STREAMED) != 0, isDiscarded = false;
+		// The last chunk of the previous result isn't the final one.
+		if ((isStreamed) && (!stmt->resultSets.empty()) && (!deliverChunk(stmt))) {
+			sqlite3_clear_bindings(handle);
+			return false;
+		}
+		SQL_ResultSet *r = new SQLite_ResultSet();
+		storeFields(r, handle);
+		stmt->resultSets.push_back(r);
+		int ret;
+		while ((ret = sqlite3_step(handle)) == SQLITE_ROW) {
+			if ((isStreamed) && (r->numRows == streamChunk)) {
+				SQL_ResultSet *next = new SQLite_ResultSet();
+				next->copyFields(r);
+				if (!deliverChunk(stmt)) {
+					delete next;
+					isDiscarded = true;
+					break;
+				}
+				r = next;
+				stmt->resultSets.push_back(r);
+			}
+			storeRow(r, handle);
+		}
+		if ((!isDiscarded) && (ret != SQLITE_DONE)) {
+			stmt->error = getErrorId();
+			stmt->errorMsg = getError();
+			stmt->copyError();
+			stmt->resultSets.pop_back();
+			delete r;
+		} else if (!isDiscarded) {
+			r->affectedRows = r->numFields == 0 ? sqlite3_changes(conn) : r->numRows;
+			r->insertId = (int) sqlite3_last_insert_rowid(conn);
+		}
+		// The statement is kept for the next execution.
+		sqlite3_reset(handle);
+		sqlite3_clear_bindings(handle);
+		return stmt->error == 0;
+	}
+
+	bool SQLite_Connection::bindParams(SQL_Statement *stmt, sqlite3_stmt *handle) {
+		for (int i = 0, count = sqlite3_bind_parameter_count(handle); i != count; ++i) {
+			int ret;
+			if (i >= (int) stmt->bindings.size()) {
+				sqlite3_bind_null(handle, i + 1);
+				continue;
+			}
+			// The values outlive the execution, so they aren't copied.
+			SQL_Value &value = stmt->bindings[i];
+			switch (value.type) {
+				case VALUE_TYPE_INT:
+					ret = sqlite3_bind_int64(handle, i + 1, value.i);
+					break;
+				case VALUE_TYPE_FLOAT:
+					ret = sqlite3_bind_double(handle, i + 1, value.f);
+					break;
+				case VALUE_TYPE_STRING:
+					ret = sqlite3_bind_text(handle, i + 1, value.str, value.len - 1, SQLITE_STATIC);
+					break;
+				default:
+					ret = sqlite3_bind_null(handle, i + 1);
+					break;
+			}
+			if (ret != SQLITE_OK) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SQLite_Connection::storeFields(SQL_ResultSet *r, sqlite3_stmt *handle) {
+		r->numFields = sqlite3_column_count(handle);
+		r->fieldNames.resize(r->numFields);
+		for (int i = 0; i != r->numFields; ++i) {
+			const char *name = sqlite3_column_name(handle, i);
+			int len = strlen(name) + 1;
+			r->fieldNames[i].first = (char*) malloc(sizeof(char) * len);
+			strcpy(r->fieldNames[i].first, name);
+			r->fieldNames[i].second = len;
+		}
+	}
+
+	void SQLite_Connection::storeRow(SQL_ResultSet *r, sqlite3_stmt *handle) {
+		r->values.push_back(std::vector<SQL_Value>(r->numFields));
+		std::vector<SQL_Value> &row = r->values.back();
+		for (int j = 0; j != r->numFields; ++j) {
+			switch (sqlite3_column_type(handle, j)) {
+				case SQLITE_INTEGER:
+					row[j].type = VALUE_TYPE_INT;
+					row[j].i = sqlite3_column_int64(handle, j);
+					break;
+				case SQLITE_FLOAT:
+					row[j].type = VALUE_TYPE_FLOAT;
+					row[j].f = sqlite3_column_double(handle, j);
+					break;
+				case SQLITE_TEXT:
+				case SQLITE_BLOB: {
+					// The length must be read after the value is converted.
+					const unsigned char *text = sqlite3_column_text(handle, j);
+					int len = sqlite3_column_bytes(handle, j);
+					row[j].type = VALUE_TYPE_STRING;
+					row[j].str = (char*) malloc(sizeof(char) * (len + 1));
+					memcpy(row[j].str, text, len);
+					row[j].str[len] = '\0';
+					row[j].len = len + 1;
+					break;
+				}
+			}
+		}
+		++r->numRows;
+	}
+
+	sqlite3_stmt *SQLite_Connection::prepare(const char *query) {
+		std::map<std::string, std::list<std::pair<std::string, sqlite3_stmt*> >::iterator>::iterator it = prepared.find(query);
+		if (it != prepared.end()) {
+			++preparedHits;
+			preparedList.splice(preparedList.begin(), preparedList, it->second);
+			return it->second->second;
+		}
+		++preparedMisses;
+		sqlite3_stmt *handle = NULL;
+		if ((sqlite3_prepare_v2(conn, query, -1, &handle, NULL) != SQLITE_OK) || (handle == NULL)) {
+			return NULL;
+		}
+		if (prepared.size() >= PREPARED_CACHE_SIZE) {
+			sqlite3_finalize(preparedList.back().second);
+			prepared.erase(preparedList.back().first);
+			preparedList.pop_back();
+			++preparedEvictions;
+		}
+		preparedList.push_front(std::make_pair(std::string(query), handle));
+		prepared[query] = preparedList.begin();
+		return handle;
+	}
+
+	void SQLite_Connection::clearPrepared() {
+		for (std::list<std::pair<std::string, sqlite3_stmt*> >::iterator it = preparedList.begin(), end = preparedList.end(); it != end; ++it) {
+			sqlite3_finalize(it->second);
+		}
+		preparedList.clear();
+		prepared.clear();
+	}
+
+	void SQLite_Connection::rollback() {
+		mutex->lock();
+		// Some errors roll back the transaction by themselves.
+		if (!sqlite3_get_autocommit(conn)) {
+			sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+		}
+		mutex->unlock();
+	}
+
+	bool SQLite_Connection::canRetry(SQL_Statement *stmt) {
+		// The lock wasn't released in time or waiting for it would have
+		// deadlocked (the busy handler isn't called then).
+		return (stmt->error & 0xff) == SQLITE_BUSY;
+	}
+
+	char *SQLite_Connection::getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert) {
+		std::string command;
+		int size = columns.size();
+		if (isUpsert) {
+			command = "INSERT INTO ";
+			command += table;
+			command += " (";
+			for (int i = 0; i != size; ++i) {
+				command += columns[i];
+				command += ", ";
+			}
+			command += key;
+			command += ") VALUES (";
+			for (int i = 0; i != size; ++i) {
+				command += "?, ";
+			}
+			command += "?) ON CONFLICT (";
+			command += key;
+			command += ") DO UPDATE SET ";
+			for (int i = 0; i != size; ++i) {
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += " = excluded.";
+				command += columns[i];
+			}
+		} else {
+			command = "UPDATE ";
+			command += table;
+			command += " SET ";
+			for (int i = 0; i != size; ++i) {
+				if (i != 0) {
+					command += ", ";
+				}
+				command += columns[i];
+				command += " = ?";
+			}
+			command += " WHERE ";
+			command += key;
+			command += " = ?";
+		}
+		char *dest = (char*) malloc(sizeof(char) * (command.length() + 1));
+		strcpy(dest, command.c_str());
+		return dest;
+	}
+
+	void SQLite_Connection::interrupt() {
+		sqlite3_interrupt(conn);
+	}
+
+	bool SQLite_Connection::keepAlive() {
+		// A local database can't be lost.
+		return conn != NULL;
+	}
+
+	bool SQLite_Connection::seekResult(SQL_Statement *stmt, int resultIdx) {
+		if (resultIdx == -1) {
+			resultIdx = stmt->lastResultIdx + 1;
+		}
+		if (stmt->lastResultIdx == resultIdx) {
+			return true;
+		}
+		if ((0 <= resultIdx) && (resultIdx < stmt->resultSets.size())) {
+			stmt->lastResultIdx = resultIdx;
+			return true;
+		}
+		return false;
+	}
+
+	bool SQLite_Connection::fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
+		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
+		if ((0 <= fieldIdx) && (fieldIdx < r->numFields)) {
+			if (dest == NULL) {
+				dest = r->fieldNames[fieldIdx].first;
+				len = r->fieldNames[fieldIdx].second;
+				return false; // It is not a copy; we warn the user that he SHOULD NOT free dest.
+			} else {
+				strncpy(dest, r->fieldNames[fieldIdx].first, len);
+				return true;
+			}
+		}
+		len = 0;
+		return true;
+	}
+
+	bool SQLite_Connection::seekRow(SQL_Statement *stmt, int rowIdx) {
+		if (stmt->resultSets.empty()) {
+			return false;
+		}
+		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
+		if (rowIdx < 0) {
+			rowIdx = r->lastRowIdx - rowIdx;
+		}
+		if (r->lastRowIdx == rowIdx) {
+			return true;
+		}
+		if ((0 <= rowIdx) && (rowIdx < r->numRows)) {
+			r->lastRowIdx = rowIdx;
+			return true;
+		}
+		return false;
+	}
+
+	bool SQLite_Connection::fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
+		return fetchValue(stmt->resultSets[stmt->lastResultIdx], fieldIdx, dest, len);
+	}
+
+	bool SQLite_Connection::fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len) {
+		if (stmt->resultSets.empty()) {
+			len = 0;
+			return true;
+		}
+		SQL_ResultSet *r = stmt->resultSets[stmt->lastResultIdx];
+		for (int i = 0, size = r->fieldNames.size(); i != size; ++i) {
+			if (strcmp(r->fieldNames[i].first, fieldName) == 0) {
+				return fetchNum(stmt, i, dest, len);
+			}
+		}
+		len = 0;
+		return true;
+	}
+
+#endif
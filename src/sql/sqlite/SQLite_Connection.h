@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2013, Dan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met: 
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer. 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution. 
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "sqlite.h"
+ 
+#ifdef PLUGIN_SUPPORTS_SQLITE
+
+	#include <list>
+	#include <map>
+	#include <string>
+
+	#include "../SQL_Connection.h"
+
+	class SQLite_Connection : public SQL_Connection {
+
+		public:
+			SQLite_Connection(int id, AMX *amx);
+			~SQLite_Connection();
+			bool connect(const char *host, const char *user, const char *pass, const char *db, int port);
+			void disconnect();
+			int getErrorId();
+			const char *getError();
+			int ping();
+			const char *getStat();
+			const char *getCharset();
+			bool setCharset(char *charset);
+			int escapeString(const char *src, char *&dest);
+			void executeStatement(SQL_Statement *stmt);
+			void rollback();
+			bool canRetry(SQL_Statement *stmt);
+			char *getWriteCommand(const char *table, const char *key, const std::vector<const char*> &columns, bool isUpsert);
+			void interrupt();
+			bool keepAlive();
+			bool seekResult(SQL_Statement *stmt, int resultIdx);
+			bool fetchField(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
+			bool seekRow(SQL_Statement *stmt, int rowIdx);
+			bool fetchNum(SQL_Statement *stmt, int fieldIdx, char *&dest, int &len);
+			bool fetchAssoc(SQL_Statement *stmt, char *fieldName, char *&dest, int &len);
+
+		private:
+
+			/**
+			 * Executes a command of a statement and stores its result (the
+			 * caller must hold `mutex`).
+			 * @param stmt
+			 * @param handle
+			 * @return `false` if the command failed (its error was stored).
+			 */
+			bool executeCommand(SQL_Statement *stmt, sqlite3_stmt *handle);
+
+			/**
+			 * Binds the parameters of a statement to a command.
+			 * @param stmt
+			 * @param handle
+			 * @return
+			 */
+			static bool bindParams(SQL_Statement *stmt, sqlite3_stmt *handle);
+
+			/**
+			 * Copies the names of the fields of a command.
+			 * @param r
+			 * @param handle
+			 */
+			static void storeFields(SQL_ResultSet *r, sqlite3_stmt *handle);
+
+			/**
+			 * Appends the current row of a command to a result set.
+			 * @param r
+			 * @param handle
+			 */
+			static void storeRow(SQL_ResultSet *r, sqlite3_stmt *handle);
+
+			/**
+			 * Gets the prepared statement of a query that has a single command,
+			 * preparing it if needed. The most recently used statements are kept.
+			 * @param query
+			 * @return NULL if the query couldn't be prepared.
+			 */
+			sqlite3_stmt *prepare(const char *query);
+
+			/**
+			 * Finalizes all prepared statements.
+			 */
+			void clearPrepared();
+
+			/**
+			 * The statements prepared on this connection (query and handle),
+			 * the most recently used first.
+			 */
+			std::list<std::pair<std::string, sqlite3_stmt*> > preparedList;
+
+			/**
+			 * Maps the queries to their entry in `preparedList`.
+			 */
+			std::map<std::string, std::list<std::pair<std::string, sqlite3_stmt*> >::iterator> prepared;
+
+			/**
+			 * The statistics returned by `getStat`.
+			 */
+			char stat[128];
+
+			/**
+			 * Synchronizes the statements executed by the main thread with the
+			 * ones executed by the worker.
+			 */
+			Mutex *mutex;
+
+			/**
+			 * The SQLite connection resource.
+			 */
+			sqlite3 *conn;
+	};
+
+#endif